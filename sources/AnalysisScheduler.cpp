@@ -0,0 +1,208 @@
+#include <JuceHeader.h>
+#include "AnalysisScheduler.h"
+#include "AnalysisWorker.h"
+
+//==============================================================================
+class AnalysisScheduler::PoolThread final : public juce::Thread
+{
+public:
+    PoolThread(AnalysisScheduler& ownerToUse, int indexToUse)
+        : juce::Thread("inPhase analysis " + juce::String(indexToUse + 1)), owner(ownerToUse), index(indexToUse)
+    {
+    }
+
+    void run() override
+    {
+        int intervalMs = pollIntervalMs;
+
+        while (! threadShouldExit())
+        {
+            // Nothing registered: sleep until add() or shutdown instead of polling empty slots
+            if (owner.numWorkers.load() == 0)
+            {
+                owner.workersAdded.wait(100.0);
+                continue;
+            }
+
+            // Clear the flag before sweeping, so samples pushed during the sweep raise it again
+            const bool flagged = owner.workPending.exchange(false, std::memory_order_acquire);
+            if (owner.serviceOwnSlots(index) || owner.stealFromOtherSlots(index))
+            {
+                // The other threads may find more of this burst
+                owner.notifyWorkPending();
+                intervalMs = pollIntervalMs;
+                continue;
+            }
+
+            // Polling keeps the audio threads free of any signalling syscalls
+            wait(intervalMs);
+            intervalMs = flagged || owner.workPending.load() ? pollIntervalMs
+                                                             : juce::jmin(intervalMs * 2, maxPollIntervalMs);
+        }
+    }
+
+private:
+    AnalysisScheduler& owner;
+    const int index;
+};
+
+//==============================================================================
+AnalysisScheduler::AnalysisScheduler()
+{
+    // Hosts run their own per-core audio threads, so stay within half the hardware threads
+    const int numCores = juce::jmin(juce::SystemStats::getNumPhysicalCpus() - 1, juce::SystemStats::getNumCpus() / 2);
+    const int numThreads = juce::jlimit(1, maxNumThreads, numCores);
+    for (int i = 0; i < numThreads; ++i)
+        threads.push_back(std::make_unique<PoolThread>(*this, i));
+
+    for (auto& thread : threads)
+        thread->startThread();
+}
+
+AnalysisScheduler::~AnalysisScheduler()
+{
+    // Every worker has removed itself by now: they hold the shared pointer that keeps the pool alive
+    jassert(numWorkers.load() == 0);
+
+    for (auto& thread : threads)
+        thread->signalThreadShouldExit();
+
+    workersAdded.signal();
+    for (auto& thread : threads)
+        thread->stopThread(1000);
+}
+
+//==============================================================================
+bool AnalysisScheduler::add(AnalysisWorker& worker)
+{
+    const juce::ScopedLock sl(registrationLock);
+
+    // Spread instances over the threads: the emptiest thread's next free slot
+    const int numThreads = getNumThreads();
+    int bestSlot = -1;
+    int bestLoad = std::numeric_limits<int>::max();
+    for (int t = 0; t < numThreads; ++t)
+    {
+        int load = 0;
+        int freeSlot = -1;
+        for (int s = t; s < maxNumWorkers; s += numThreads)
+        {
+            if (slots[static_cast<size_t>(s)].worker.load() != nullptr)
+                ++load;
+            else if (freeSlot < 0)
+                freeSlot = s;
+        }
+
+        if (freeSlot >= 0 && load < bestLoad)
+        {
+            bestLoad = load;
+            bestSlot = freeSlot;
+        }
+    }
+
+    jassert(bestSlot >= 0); // More instances than slots
+    if (bestSlot < 0)
+        return false;
+
+    slots[static_cast<size_t>(bestSlot)].worker.store(&worker);
+    registeredSlots[static_cast<size_t>(bestSlot / 64)].fetch_or(juce::uint64(1) << (bestSlot % 64));
+    numWorkers.fetch_add(1);
+    workersAdded.signal();
+    return true;
+}
+
+void AnalysisScheduler::remove(AnalysisWorker& worker)
+{
+    const juce::ScopedLock sl(registrationLock);
+
+    for (int s = 0; s < maxNumWorkers; ++s)
+    {
+        auto& slot = slots[static_cast<size_t>(s)];
+        if (slot.worker.load() != &worker)
+            continue;
+
+        // No new visitor can see the worker after this; wait for the ones that already do.
+        // The last of them sees the null pointer and signals, so no wakeup is lost.
+        registeredSlots[static_cast<size_t>(s / 64)].fetch_and(~(juce::uint64(1) << (s % 64)));
+        slot.worker.store(nullptr);
+        while (slot.numVisitors.load() != 0)
+            visitorLeft.wait();
+
+        if (numWorkers.fetch_sub(1) == 1)
+            workersAdded.reset();
+        return;
+    }
+}
+
+//==============================================================================
+bool AnalysisScheduler::serviceSlot(Slot& slot)
+{
+    // Announce the visit before reading the pointer, so remove() cannot free the worker underneath
+    slot.numVisitors.fetch_add(1);
+    bool didWork = false;
+
+    if (auto* worker = slot.worker.load())
+    {
+        bool expected = false;
+        if (worker->hasPendingWork() && slot.busy.compare_exchange_strong(expected, true))
+        {
+            didWork = worker->service();
+            slot.busy.store(false);
+        }
+    }
+
+    if (slot.numVisitors.fetch_sub(1) == 1 && slot.worker.load() == nullptr)
+        visitorLeft.signal();
+
+    return didWork;
+}
+
+template <typename Function>
+void AnalysisScheduler::forEachRegisteredSlot(int firstSlot, Function&& function)
+{
+    // The first word is visited twice: its bits from firstSlot up at the start, the ones below at the end
+    const int firstBit = firstSlot % 64;
+    for (int i = 0; i <= numMaskWords; ++i)
+    {
+        const int word = (firstSlot / 64 + i) % numMaskWords;
+        auto bits = registeredSlots[static_cast<size_t>(word)].load();
+        if (i == 0)
+            bits &= ~juce::uint64(0) << firstBit;
+        else if (i == numMaskWords)
+            bits &= (juce::uint64(1) << firstBit) - 1;
+
+        while (bits != 0)
+        {
+            const int bit = juce::countNumberOfBits((bits & (~bits + 1)) - 1); // Index of the lowest set bit
+            bits &= bits - 1;
+            function(word * 64 + bit);
+        }
+    }
+}
+
+bool AnalysisScheduler::serviceOwnSlots(int threadIndex)
+{
+    const int numThreads = getNumThreads();
+    bool didWork = false;
+    forEachRegisteredSlot(threadIndex, [&](int s)
+    {
+        if (s % numThreads == threadIndex)
+            didWork = serviceSlot(slots[static_cast<size_t>(s)]) || didWork;
+    });
+
+    return didWork;
+}
+
+bool AnalysisScheduler::stealFromOtherSlots(int threadIndex)
+{
+    // Start after our own slots so the thieves of one owner don't all pile onto the same victim
+    const int numThreads = getNumThreads();
+    bool didWork = false;
+    forEachRegisteredSlot((threadIndex + 1) % maxNumWorkers, [&](int s)
+    {
+        if (s % numThreads != threadIndex)
+            didWork = serviceSlot(slots[static_cast<size_t>(s)]) || didWork;
+    });
+
+    return didWork;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+class AnalysisWorker;
+
+//==============================================================================
+// One analysis thread pool per process, shared by every plugin instance.
+// Hold it through juce::SharedResourcePointer<AnalysisScheduler>: the pool starts
+// with the first instance and stops when the last one goes away.
+//
+// Each registered AnalysisWorker sits in a fixed slot, and each pool thread owns
+// every numThreads-th slot. A thread services its own workers first. When none of
+// them has work, it steals from the other threads' slots, so a burst from a few
+// instances spreads over every core. A per-slot busy flag keeps one worker on one
+// thread at a time, so its callbacks still arrive in stream order. Threads only
+// visit the slots set in an occupancy mask, and every slot has a cache line to
+// itself, so polling costs little with few instances. The audio
+// threads never wake the pool: they fill each worker's FIFO and raise a shared
+// work flag, which the pool polls. After a sweep that found nothing and no flag
+// raised, a thread doubles its wait up to maxPollIntervalMs, so idle instances
+// cost a few wakeups a second rather than one every couple of milliseconds.
+//
+// The pool takes at most half the host's hardware threads, and never more than
+// maxNumThreads, leaving the rest to the host's own audio threads.
+class AnalysisScheduler
+{
+public:
+    //==============================================================================
+    AnalysisScheduler();
+    ~AnalysisScheduler();
+
+    // Message thread. add() returns false when every slot is taken.
+    // remove() returns once no pool thread is inside the worker any more.
+    bool add(AnalysisWorker& worker);
+    void remove(AnalysisWorker& worker);
+
+    int getNumThreads() const { return static_cast<int>(threads.size()); }
+
+    // Audio thread: wait-free. A worker calls this after queueing samples or a reset.
+    void notifyWorkPending() { workPending.store(true, std::memory_order_release); }
+
+    static constexpr int maxNumWorkers = 256;
+    static constexpr int maxNumThreads = 8;
+
+private:
+    //==============================================================================
+    class PoolThread;
+
+    struct alignas(64) Slot
+    {
+        std::atomic<AnalysisWorker*> worker { nullptr };
+        std::atomic<int> numVisitors { 0 };     // Pool threads holding the pointer; remove() waits for zero
+        std::atomic<bool> busy { false };       // A pool thread is servicing the worker
+    };
+
+    bool serviceSlot(Slot& slot);
+    bool serviceOwnSlots(int threadIndex);
+    bool stealFromOtherSlots(int threadIndex);
+
+    // Calls function(slotIndex) for every registered slot, from firstSlot upwards and wrapping round
+    template <typename Function>
+    void forEachRegisteredSlot(int firstSlot, Function&& function);
+
+    static constexpr int numMaskWords = maxNumWorkers / 64;
+
+    std::array<Slot, maxNumWorkers> slots;
+    std::array<std::atomic<juce::uint64>, numMaskWords> registeredSlots {};  // One bit per slot holding a worker
+    std::vector<std::unique_ptr<PoolThread>> threads;
+    std::atomic<int> numWorkers { 0 };
+    juce::WaitableEvent workersAdded { true };  // Idle threads sleep on this while no worker is registered
+    juce::WaitableEvent visitorLeft;            // A pool thread left a slot whose worker is being removed
+    juce::CriticalSection registrationLock;
+    std::atomic<bool> workPending { false };    // Raised by the audio threads, cleared by whichever pool thread sees it
+    static constexpr int pollIntervalMs = 2;    // While work keeps arriving
+    static constexpr int maxPollIntervalMs = 32; // Back-off limit after empty sweeps
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AnalysisScheduler)
+};
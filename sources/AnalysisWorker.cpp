@@ -0,0 +1,162 @@
+#include <JuceHeader.h>
+#include "AnalysisWorker.h"
+
+//==============================================================================
+AnalysisWorker::AnalysisWorker(Listener& listenerToUse)
+    : listener(listenerToUse)
+{
+}
+
+AnalysisWorker::~AnalysisWorker()
+{
+    stop();
+}
+
+//==============================================================================
+void AnalysisWorker::prepare(int newWindowSize, int maxBlockSize, int maxNumTargets)
+{
+    jassert(! registered); // stop() before resizing the buffers
+    const int numChannels = 1 + juce::jmax(1, maxNumTargets);
+
+    // Room for a few windows' worth of blocks so a briefly descheduled worker doesn't drop data
+    const int fifoSize = 4 * juce::jmax(newWindowSize, maxBlockSize) + 1;
+    fifo.setTotalSize(fifoSize);
+    fifoBuffer.setSize(numChannels, fifoSize);
+    fifoBuffer.clear();
+
+    windowSize = juce::jmax(1, newWindowSize);
+    windowRings.clear();
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        windowRings.push_back(std::make_unique<MirroredRingBuffer>());
+        windowRings.back()->allocate(windowSize);
+    }
+    windowChannels.allocate(static_cast<size_t>(numChannels), true);
+    updateWindow();
+
+    drainTargets.allocate(static_cast<size_t>(numChannels - 1), true);
+    numTargetsInFifo.store(1);
+
+    resetRequested.store(false);
+    resetPoint.store(0);
+    totalPushed.store(0);
+    totalDrained = 0;
+    droppedBlocks.store(0);
+}
+
+void AnalysisWorker::start()
+{
+    if (! registered)
+        registered = scheduler->add(*this);
+}
+
+void AnalysisWorker::stop()
+{
+    if (registered)
+        scheduler->remove(*this);
+
+    registered = false;
+}
+
+//==============================================================================
+void AnalysisWorker::pushBlock(const float* ref, const float* const* targets, int numTargets, int numSamples)
+{
+    if (numSamples <= 0)
+        return;
+
+    // A change in target count is followed by a reset from the processor, which discards anything queued before it
+    numTargets = juce::jlimit(1, fifoBuffer.getNumChannels() - 1, numTargets);
+    numTargetsInFifo.store(numTargets);
+
+    // Drop the whole block rather than a partial one if the worker has fallen behind
+    if (fifo.getFreeSpace() < numSamples)
+    {
+        droppedBlocks.fetch_add(1);
+        return;
+    }
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+    if (size1 > 0)
+    {
+        fifoBuffer.copyFrom(0, start1, ref, size1);
+        for (int t = 0; t < numTargets; ++t)
+            fifoBuffer.copyFrom(1 + t, start1, targets[t], size1);
+    }
+
+    if (size2 > 0)
+    {
+        fifoBuffer.copyFrom(0, start2, ref + size1, size2);
+        for (int t = 0; t < numTargets; ++t)
+            fifoBuffer.copyFrom(1 + t, start2, targets[t] + size1, size2);
+    }
+
+    fifo.finishedWrite(size1 + size2);
+    totalPushed.store(totalPushed.load(std::memory_order_relaxed) + numSamples, std::memory_order_release);
+    scheduler->notifyWorkPending();
+}
+
+//==============================================================================
+bool AnalysisWorker::service()
+{
+    if (! drainFifo())
+        return false;
+
+    updateWindow();
+    listener.analysisWindowUpdated(window, numTargetsInFifo.load());
+    return true;
+}
+
+void AnalysisWorker::updateWindow()
+{
+    // The rings moved on: point every channel at its newest windowSize samples again
+    for (size_t ch = 0; ch < windowRings.size(); ++ch)
+        windowChannels[ch] = const_cast<float*>(windowRings[ch]->getNewest(windowSize));
+
+    window.setDataToReferTo(windowChannels, static_cast<int>(windowRings.size()), windowSize);
+}
+
+bool AnalysisWorker::drainFifo()
+{
+    if (resetRequested.exchange(false, std::memory_order_acquire))
+    {
+        // Whatever was queued before the request is stale; anything pushed since belongs to the new stream
+        const auto numStale = juce::jlimit(0, fifo.getNumReady(), static_cast<int>(resetPoint.load(std::memory_order_relaxed) - totalDrained));
+        fifo.finishedRead(numStale);
+        totalDrained += numStale;
+        for (auto& ring : windowRings)
+            ring->clear();
+        listener.analysisReset();
+    }
+
+    const int numReady = fifo.getNumReady();
+    if (numReady <= 0)
+        return false;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(numReady, start1, size1, start2, size2);
+
+    if (size1 > 0)
+        writeToWindow(start1, size1);
+
+    if (size2 > 0)
+        writeToWindow(start2, size2);
+
+    fifo.finishedRead(size1 + size2);
+    totalDrained += size1 + size2;
+    return true;
+}
+
+void AnalysisWorker::writeToWindow(int fifoStart, int numSamples)
+{
+    const int numTargets = numTargetsInFifo.load();
+    for (int t = 0; t < numTargets; ++t)
+        drainTargets[t] = fifoBuffer.getReadPointer(1 + t, fifoStart);
+
+    listener.analysisSamplesReceived(fifoBuffer.getReadPointer(0, fifoStart), drainTargets, numTargets, numSamples);
+
+    // Each ring keeps only its newest samples, so a long run costs no more than a window
+    for (int ch = 0; ch <= numTargets; ++ch)
+        windowRings[static_cast<size_t>(ch)]->write(fifoBuffer.getReadPointer(ch, fifoStart), numSamples);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "AnalysisScheduler.h"
+#include "MirroredRingBuffer.h"
+
+//==============================================================================
+// Runs delay estimation off the audio thread.
+// The audio thread only pushes one reference and up to maxNumTargets target channels
+// into a single-producer, single-consumer juce::AbstractFifo (wait-free, no locks, no
+// allocation). A thread of the process-wide AnalysisScheduler pool drains it into one
+// MirroredRingBuffer per channel and notifies the listener whenever new samples have
+// arrived. The window handed to the listener refers straight into those rings: the
+// newest windowSize samples, oldest first, with no unwrapping copy.
+// Results go back through the listener's own slots, which processBlock() reads.
+class AnalysisWorker final
+{
+public:
+    //==============================================================================
+    // All callbacks arrive on a pool thread, never on two at once.
+    class Listener
+    {
+    public:
+        virtual ~Listener() = default;
+
+        // Each run of samples as it is drained from the FIFO, in stream order
+        virtual void analysisSamplesReceived(const float* ref, const float* const* targets, int numTargets, int numSamples)
+        {
+            juce::ignoreUnused(ref, targets, numTargets, numSamples);
+        }
+
+        // After a drain that delivered new samples. Channel 0 of the window is the reference, channels 1 .. numTargets the targets.
+        // Sample 0 is the oldest; the window is only valid during the call.
+        virtual void analysisWindowUpdated(const juce::AudioBuffer<float>& window, int numTargets) = 0;
+
+        // The audio thread asked for a reset, so the stream is discontinuous from here on
+        virtual void analysisReset() {}
+    };
+
+    explicit AnalysisWorker(Listener& listenerToUse);
+    ~AnalysisWorker();
+
+    //==============================================================================
+    // Message thread: the worker must be stopped while it is (re)prepared.
+    // stop() returns once no pool thread is inside the listener any more.
+    void prepare(int windowSize, int maxBlockSize, int maxNumTargets = 1);
+    void start();
+    void stop();
+
+    //==============================================================================
+    // Audio thread: wait-free.
+    void pushBlock(const float* ref, const float* target, int numSamples) { pushBlock(ref, &target, 1, numSamples); }
+    void pushBlock(const float* ref, const float* const* targets, int numTargets, int numSamples);
+    // Discards what was pushed before the call; blocks pushed after it are kept
+    void requestReset()
+    {
+        resetPoint.store(totalPushed.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        resetRequested.store(true, std::memory_order_release);
+        scheduler->notifyWorkPending();
+    }
+    int getNumDroppedBlocks() const { return droppedBlocks.load(); }
+
+    //==============================================================================
+    // Pool threads, one at a time
+    bool hasPendingWork() const { return resetRequested.load() || fifo.getNumReady() > 0; }
+    bool service();
+
+private:
+    //==============================================================================
+    bool drainFifo();
+    void writeToWindow(int fifoStart, int numSamples);
+    void updateWindow();
+
+    Listener& listener;
+    juce::SharedResourcePointer<AnalysisScheduler> scheduler;
+    bool registered = false;
+    juce::AbstractFifo fifo { 1 };
+    juce::AudioBuffer<float> fifoBuffer;
+    std::vector<std::unique_ptr<MirroredRingBuffer>> windowRings;   // reference, then one per target
+    juce::AudioBuffer<float> window;                // Refers into windowRings, repointed after every drain
+    juce::HeapBlock<float*> windowChannels;
+    juce::HeapBlock<const float*> drainTargets;    // per-target read pointers handed to the listener
+    int windowSize = 1;
+    std::atomic<int> numTargetsInFifo { 1 };
+    std::atomic<bool> resetRequested { false };
+    std::atomic<juce::int64> resetPoint { 0 };     // totalPushed when the last reset was requested
+    std::atomic<juce::int64> totalPushed { 0 };    // Samples queued since prepare(); written by the audio thread only
+    juce::int64 totalDrained = 0;                  // Samples taken off the FIFO, read or discarded; pool thread only
+    std::atomic<int> droppedBlocks { 0 };
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AnalysisWorker)
+};
@@ -0,0 +1,459 @@
+#include <JuceHeader.h>
+#include "CorrelationKernels.h"
+
+#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #include <immintrin.h>
+ #if defined (_MSC_VER)
+  #include <intrin.h>
+ #else
+  #include <cpuid.h>
+ #endif
+ #define INPHASE_USE_SSE2 1
+#elif defined (__ARM_NEON__) || defined (__ARM_NEON) || defined (_M_ARM64)
+ #include <arm_neon.h>
+ #define INPHASE_USE_NEON 1
+#endif
+
+// The AVX2 and AVX-512 kernels are compiled for their instruction set function by function,
+// so the rest of the plugin keeps the baseline target and getIsa() decides at runtime
+#if INPHASE_USE_SSE2 && (defined (__GNUC__) || defined (__clang__))
+ #define INPHASE_TARGET(isa) __attribute__ ((target (isa)))
+#else
+ #define INPHASE_TARGET(isa)
+#endif
+
+//==============================================================================
+float CorrelationKernels::dotProduct(const float* a, const float* b, int numSamples)
+{
+    int i = 0;
+    float sum = 0.0f;
+
+   #if INPHASE_USE_SSE2
+    // Two accumulators hide the add latency
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, _mm_add_ps(acc0, acc1));
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+   #elif INPHASE_USE_NEON
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+
+    alignas(16) float lanes[4];
+    vst1q_f32(lanes, vaddq_f32(acc0, acc1));
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+   #endif
+
+    // Scalar tail (and the whole loop on targets without SIMD)
+    for (; i < numSamples; ++i)
+        sum += a[i] * b[i];
+
+    return sum;
+}
+
+float CorrelationKernels::refinePeak(const float* ref, const float* target, int numSamples, int firstLag, int lastLag)
+{
+    firstLag = juce::jmax(0, firstLag);
+    int bestLag = firstLag;
+    float bestCorrelation = -std::numeric_limits<float>::infinity();
+    for (int lag = firstLag; lag <= lastLag; ++lag)
+    {
+        const float sum = dotProduct(ref, target + lag, numSamples);
+        if (sum > bestCorrelation)
+        {
+            bestCorrelation = sum;
+            bestLag = lag;
+        }
+    }
+
+    // Parabolic interpolation through the peak and its neighbours
+    if (bestLag <= 0)
+        return static_cast<float>(bestLag);
+
+    const float left = dotProduct(ref, target + bestLag - 1, numSamples);
+    const float right = dotProduct(ref, target + bestLag + 1, numSamples);
+    const float curvature = left - 2.0f * bestCorrelation + right;
+    if (curvature >= 0.0f)
+        return static_cast<float>(bestLag); // not a maximum, nothing to refine
+
+    return static_cast<float>(bestLag) + juce::jlimit(-0.5f, 0.5f, 0.5f * (left - right) / curvature);
+}
+
+float CorrelationKernels::peakToSidelobeRatio(const float* correlation, int numLags, int peakIndex)
+{
+    if (! juce::isPositiveAndBelow(peakIndex, numLags) || correlation[peakIndex] <= 0.0f)
+        return minConfidenceDb;
+
+    // Walk down both flanks of the main lobe
+    int lobeStart = peakIndex;
+    while (lobeStart > 0 && correlation[lobeStart - 1] < correlation[lobeStart])
+        --lobeStart;
+
+    int lobeEnd = peakIndex;
+    while (lobeEnd < numLags - 1 && correlation[lobeEnd + 1] < correlation[lobeEnd])
+        ++lobeEnd;
+
+    // Largest magnitude left of and right of the lobe
+    float sidelobe = 0.0f;
+    if (lobeStart > 0)
+    {
+        const auto range = juce::FloatVectorOperations::findMinAndMax(correlation, lobeStart);
+        sidelobe = juce::jmax(sidelobe, -range.getStart(), range.getEnd());
+    }
+    if (lobeEnd < numLags - 1)
+    {
+        const auto range = juce::FloatVectorOperations::findMinAndMax(correlation + lobeEnd + 1, numLags - lobeEnd - 1);
+        sidelobe = juce::jmax(sidelobe, -range.getStart(), range.getEnd());
+    }
+
+    if (sidelobe <= correlation[peakIndex] * 1.0e-3f)
+        return maxConfidenceDb;
+
+    return juce::jmin(maxConfidenceDb, juce::Decibels::gainToDecibels(correlation[peakIndex] / sidelobe));
+}
+
+//==============================================================================
+namespace
+{
+    // Scalar end of a block of four lags starting at target: the samples past the vector loop,
+    // then the extra overlap of the shorter lags. Lag j of the block overlaps overlap - j samples.
+    void finishLagBlock(const float* ref, const float* target, int overlap, int vectorEnd, float* sums)
+    {
+        for (int j = 0; j < 4; ++j)
+            for (int i = vectorEnd; i < overlap - j; ++i)
+                sums[j] += ref[i] * target[i + j];
+    }
+
+    // The lags left over after the blocks of four, one dot product each
+    void correlateEachLag(const float* ref, const float* target, int numSamples, int firstLag, int numLags, float* correlation)
+    {
+        for (int k = 0; k < numLags; ++k)
+            correlation[k] = CorrelationKernels::dotProduct(ref, target + firstLag + k, numSamples - firstLag - k);
+    }
+
+   #if INPHASE_USE_SSE2
+    //==============================================================================
+    // Each block of four lags runs whole inner blocks of tapsPerBlock taps first. The inner block's trip count
+    // is a constant, so it unrolls completely. The taps left over, and the extra overlap of the shorter lags, run
+    // in a generic remainder. Every kernel is a template on the window size: 0 takes any size, the others only
+    // their own, which makes the number of inner blocks per lag a constant expression of the lag.
+    constexpr int tapsPerBlock = 64;     // A multiple of every vector width below
+
+    inline void accumulateBlockSse2(const float* ref, const float* t, __m128& acc0, __m128& acc1, __m128& acc2, __m128& acc3)
+    {
+        for (int i = 0; i < tapsPerBlock; i += 4)
+        {
+            const __m128 r = _mm_loadu_ps(ref + i);
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(r, _mm_loadu_ps(t + i)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(r, _mm_loadu_ps(t + i + 1)));
+            acc2 = _mm_add_ps(acc2, _mm_mul_ps(r, _mm_loadu_ps(t + i + 2)));
+            acc3 = _mm_add_ps(acc3, _mm_mul_ps(r, _mm_loadu_ps(t + i + 3)));
+        }
+    }
+
+    template <int windowSize>
+    void correlateSse2(const float* ref, const float* target, int numSamples, int firstLag, int numLags, float* correlation)
+    {
+        if constexpr (windowSize > 0)
+        {
+            jassert(numSamples == windowSize); // Picked for another window size
+            numSamples = windowSize;
+        }
+
+        int k = 0;
+        for (; k + 4 <= numLags; k += 4)
+        {
+            const int lag = firstLag + k;
+            const float* t = target + lag;
+            const int common = numSamples - lag - 3; // Overlap shared by all four lags
+
+            __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps(), acc2 = _mm_setzero_ps(), acc3 = _mm_setzero_ps();
+            int i = 0;
+            for (; i + tapsPerBlock <= common; i += tapsPerBlock)
+                accumulateBlockSse2(ref + i, t + i, acc0, acc1, acc2, acc3);
+
+            for (; i + 4 <= common; i += 4)
+            {
+                const __m128 r = _mm_loadu_ps(ref + i);
+                acc0 = _mm_add_ps(acc0, _mm_mul_ps(r, _mm_loadu_ps(t + i)));
+                acc1 = _mm_add_ps(acc1, _mm_mul_ps(r, _mm_loadu_ps(t + i + 1)));
+                acc2 = _mm_add_ps(acc2, _mm_mul_ps(r, _mm_loadu_ps(t + i + 2)));
+                acc3 = _mm_add_ps(acc3, _mm_mul_ps(r, _mm_loadu_ps(t + i + 3)));
+            }
+
+            // After the transpose, lane j of the sum is the total of accumulator j
+            _MM_TRANSPOSE4_PS(acc0, acc1, acc2, acc3);
+            alignas(16) float sums[4];
+            _mm_store_ps(sums, _mm_add_ps(_mm_add_ps(acc0, acc1), _mm_add_ps(acc2, acc3)));
+
+            finishLagBlock(ref, t, numSamples - lag, i, sums);
+            std::copy(sums, sums + 4, correlation + k);
+        }
+
+        correlateEachLag(ref, target, numSamples, firstLag + k, numLags - k, correlation + k);
+    }
+
+    INPHASE_TARGET ("avx2,fma") inline void accumulateBlockAvx2(const float* ref, const float* t, __m256& acc0, __m256& acc1, __m256& acc2, __m256& acc3)
+    {
+        for (int i = 0; i < tapsPerBlock; i += 8)
+        {
+            const __m256 r = _mm256_loadu_ps(ref + i);
+            acc0 = _mm256_fmadd_ps(r, _mm256_loadu_ps(t + i), acc0);
+            acc1 = _mm256_fmadd_ps(r, _mm256_loadu_ps(t + i + 1), acc1);
+            acc2 = _mm256_fmadd_ps(r, _mm256_loadu_ps(t + i + 2), acc2);
+            acc3 = _mm256_fmadd_ps(r, _mm256_loadu_ps(t + i + 3), acc3);
+        }
+    }
+
+    template <int windowSize>
+    INPHASE_TARGET ("avx2,fma") void correlateAvx2(const float* ref, const float* target, int numSamples, int firstLag, int numLags, float* correlation)
+    {
+        if constexpr (windowSize > 0)
+        {
+            jassert(numSamples == windowSize); // Picked for another window size
+            numSamples = windowSize;
+        }
+
+        int k = 0;
+        for (; k + 4 <= numLags; k += 4)
+        {
+            const int lag = firstLag + k;
+            const float* t = target + lag;
+            const int common = numSamples - lag - 3; // Overlap shared by all four lags
+
+            __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps(), acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+            int i = 0;
+            for (; i + tapsPerBlock <= common; i += tapsPerBlock)
+                accumulateBlockAvx2(ref + i, t + i, acc0, acc1, acc2, acc3);
+
+            for (; i + 8 <= common; i += 8)
+            {
+                const __m256 r = _mm256_loadu_ps(ref + i);
+                acc0 = _mm256_fmadd_ps(r, _mm256_loadu_ps(t + i), acc0);
+                acc1 = _mm256_fmadd_ps(r, _mm256_loadu_ps(t + i + 1), acc1);
+                acc2 = _mm256_fmadd_ps(r, _mm256_loadu_ps(t + i + 2), acc2);
+                acc3 = _mm256_fmadd_ps(r, _mm256_loadu_ps(t + i + 3), acc3);
+            }
+
+            // Fold each accumulator to 128 bits, then the same horizontal sums as SSE2
+            __m128 sum0 = _mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1));
+            __m128 sum1 = _mm_add_ps(_mm256_castps256_ps128(acc1), _mm256_extractf128_ps(acc1, 1));
+            __m128 sum2 = _mm_add_ps(_mm256_castps256_ps128(acc2), _mm256_extractf128_ps(acc2, 1));
+            __m128 sum3 = _mm_add_ps(_mm256_castps256_ps128(acc3), _mm256_extractf128_ps(acc3, 1));
+            _MM_TRANSPOSE4_PS(sum0, sum1, sum2, sum3);
+            alignas(16) float sums[4];
+            _mm_store_ps(sums, _mm_add_ps(_mm_add_ps(sum0, sum1), _mm_add_ps(sum2, sum3)));
+
+            finishLagBlock(ref, t, numSamples - lag, i, sums);
+            std::copy(sums, sums + 4, correlation + k);
+        }
+
+        correlateEachLag(ref, target, numSamples, firstLag + k, numLags - k, correlation + k);
+    }
+
+    INPHASE_TARGET ("avx512f") inline void accumulateBlockAvx512(const float* ref, const float* t, __m512& acc0, __m512& acc1, __m512& acc2, __m512& acc3)
+    {
+        for (int i = 0; i < tapsPerBlock; i += 16)
+        {
+            const __m512 r = _mm512_loadu_ps(ref + i);
+            acc0 = _mm512_fmadd_ps(r, _mm512_loadu_ps(t + i), acc0);
+            acc1 = _mm512_fmadd_ps(r, _mm512_loadu_ps(t + i + 1), acc1);
+            acc2 = _mm512_fmadd_ps(r, _mm512_loadu_ps(t + i + 2), acc2);
+            acc3 = _mm512_fmadd_ps(r, _mm512_loadu_ps(t + i + 3), acc3);
+        }
+    }
+
+    template <int windowSize>
+    INPHASE_TARGET ("avx512f") void correlateAvx512(const float* ref, const float* target, int numSamples, int firstLag, int numLags, float* correlation)
+    {
+        if constexpr (windowSize > 0)
+        {
+            jassert(numSamples == windowSize); // Picked for another window size
+            numSamples = windowSize;
+        }
+
+        int k = 0;
+        for (; k + 4 <= numLags; k += 4)
+        {
+            const int lag = firstLag + k;
+            const float* t = target + lag;
+            const int common = numSamples - lag - 3; // Overlap shared by all four lags
+
+            __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps(), acc2 = _mm512_setzero_ps(), acc3 = _mm512_setzero_ps();
+            int i = 0;
+            for (; i + tapsPerBlock <= common; i += tapsPerBlock)
+                accumulateBlockAvx512(ref + i, t + i, acc0, acc1, acc2, acc3);
+
+            for (; i + 16 <= common; i += 16)
+            {
+                const __m512 r = _mm512_loadu_ps(ref + i);
+                acc0 = _mm512_fmadd_ps(r, _mm512_loadu_ps(t + i), acc0);
+                acc1 = _mm512_fmadd_ps(r, _mm512_loadu_ps(t + i + 1), acc1);
+                acc2 = _mm512_fmadd_ps(r, _mm512_loadu_ps(t + i + 2), acc2);
+                acc3 = _mm512_fmadd_ps(r, _mm512_loadu_ps(t + i + 3), acc3);
+            }
+
+            float sums[4] = { _mm512_reduce_add_ps(acc0), _mm512_reduce_add_ps(acc1), _mm512_reduce_add_ps(acc2), _mm512_reduce_add_ps(acc3) };
+            finishLagBlock(ref, t, numSamples - lag, i, sums);
+            std::copy(sums, sums + 4, correlation + k);
+        }
+
+        correlateEachLag(ref, target, numSamples, firstLag + k, numLags - k, correlation + k);
+    }
+
+    //==============================================================================
+    // The window sizes the plugin runs: the fine pass over the analysis window at 44.1 to 192 kHz,
+    // and the coarse pass over a quarter of it
+    struct SpecialisedKernel
+    {
+        CorrelationKernels::Isa isa;
+        int windowSize;
+        CorrelationKernels::CorrelateFunction function;
+    };
+
+    constexpr SpecialisedKernel specialisedKernels[] =
+    {
+        { CorrelationKernels::Isa::sse2,   512,  correlateSse2<512> },
+        { CorrelationKernels::Isa::sse2,   1024, correlateSse2<1024> },
+        { CorrelationKernels::Isa::sse2,   2048, correlateSse2<2048> },
+        { CorrelationKernels::Isa::sse2,   4096, correlateSse2<4096> },
+        { CorrelationKernels::Isa::sse2,   8192, correlateSse2<8192> },
+        { CorrelationKernels::Isa::avx2,   512,  correlateAvx2<512> },
+        { CorrelationKernels::Isa::avx2,   1024, correlateAvx2<1024> },
+        { CorrelationKernels::Isa::avx2,   2048, correlateAvx2<2048> },
+        { CorrelationKernels::Isa::avx2,   4096, correlateAvx2<4096> },
+        { CorrelationKernels::Isa::avx2,   8192, correlateAvx2<8192> },
+        { CorrelationKernels::Isa::avx512, 512,  correlateAvx512<512> },
+        { CorrelationKernels::Isa::avx512, 1024, correlateAvx512<1024> },
+        { CorrelationKernels::Isa::avx512, 2048, correlateAvx512<2048> },
+        { CorrelationKernels::Isa::avx512, 4096, correlateAvx512<4096> },
+        { CorrelationKernels::Isa::avx512, 8192, correlateAvx512<8192> },
+    };
+
+    //==============================================================================
+    // XCR0 bits of the register state the OS saves on a context switch: SSE and AVX, then the
+    // AVX-512 opmask and upper ZMM registers. A CPU can report AVX-512 while the OS leaves them off.
+    constexpr unsigned long long avxStates = 0x06;
+    constexpr unsigned long long avx512States = 0xe6;
+
+    bool isSavedByOs(unsigned long long states)
+    {
+      #if defined (_MSC_VER)
+        int info[4];
+        __cpuid(info, 1);
+        if ((info[2] & (1 << 27)) == 0) // OSXSAVE: XGETBV is usable
+            return false;
+
+        return (_xgetbv(0) & states) == states;
+      #else
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+        if (! __get_cpuid(1, &eax, &ebx, &ecx, &edx) || (ecx & bit_OSXSAVE) == 0)
+            return false;
+
+        unsigned int low = 0, high = 0;
+        __asm__ ("xgetbv" : "=a" (low), "=d" (high) : "c" (0)); // No -mxsave needed, unlike _xgetbv()
+        return (((static_cast<unsigned long long>(high) << 32) | low) & states) == states;
+      #endif
+    }
+   #endif
+}
+
+CorrelationKernels::Isa CorrelationKernels::getIsa()
+{
+    // The CPU doesn't change while the plugin is loaded
+    static const Isa isa = []
+    {
+        for (auto candidate : { Isa::avx512, Isa::avx2, Isa::sse2 })
+            if (isAvailable(candidate))
+                return candidate;
+
+        return Isa::generic;
+    }();
+
+    return isa;
+}
+
+bool CorrelationKernels::isAvailable(Isa isa)
+{
+    switch (isa)
+    {
+       #if INPHASE_USE_SSE2
+        case Isa::avx512:   return juce::SystemStats::hasAVX512F() && isSavedByOs(avx512States);
+        case Isa::avx2:     return juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3() && isSavedByOs(avxStates);
+        case Isa::sse2:     return true;
+       #else
+        case Isa::avx512:
+        case Isa::avx2:
+        case Isa::sse2:     return false;
+       #endif
+        case Isa::generic:  return true;
+    }
+
+    return false;
+}
+
+const char* CorrelationKernels::getIsaName(Isa isa)
+{
+    switch (isa)
+    {
+        case Isa::generic:  return "generic";
+        case Isa::sse2:     return "SSE2";
+        case Isa::avx2:     return "AVX2";
+        case Isa::avx512:   return "AVX-512";
+    }
+
+    return "unknown";
+}
+
+CorrelationKernels::CorrelateFunction CorrelationKernels::getCorrelateFunction(Isa isa, int windowSize)
+{
+    jassert(isAvailable(isa)); // This CPU can't run it
+
+   #if INPHASE_USE_SSE2
+    for (const auto& kernel : specialisedKernels)
+        if (kernel.isa == isa && kernel.windowSize == windowSize)
+            return kernel.function;
+   #endif
+
+    switch (isa)
+    {
+       #if INPHASE_USE_SSE2
+        case Isa::avx512:   return correlateAvx512<0>;
+        case Isa::avx2:     return correlateAvx2<0>;
+        case Isa::sse2:     return correlateSse2<0>;
+       #else
+        case Isa::avx512:
+        case Isa::avx2:
+        case Isa::sse2:
+       #endif
+        case Isa::generic:  return correlateEachLag;
+    }
+
+    return correlateEachLag;
+}
+
+bool CorrelationKernels::isSpecialised(Isa isa, int windowSize)
+{
+   #if INPHASE_USE_SSE2
+    for (const auto& kernel : specialisedKernels)
+        if (kernel.isa == isa && kernel.windowSize == windowSize)
+            return true;
+   #endif
+
+    juce::ignoreUnused(isa, windowSize);
+    return false;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+//==============================================================================
+// Vectorized inner loops shared by the delay estimators.
+//
+// Lag convention, used by every estimator: the lag of a target is the one for which
+// target[i + lag] best matches ref[i]. A positive lag means the target is late, and
+// the estimators search lags in [0, maxLagSamples].
+namespace CorrelationKernels
+{
+    // sum(a[i] * b[i]) for i in [0, numSamples). Unaligned inputs are fine.
+    float dotProduct(const float* a, const float* b, int numSamples);
+
+    // Confidence of a correlation peak, in dB: the peak over the largest magnitude outside its main lobe.
+    // The main lobe extends from peakIndex for as long as the correlation keeps falling on each side.
+    // A flat or noisy correlation gives a value near 0 dB; a non-positive peak gives minConfidenceDb.
+    float peakToSidelobeRatio(const float* correlation, int numLags, int peakIndex);
+
+    // Full-rate search of a coarse peak: the lag in [firstLag, lastLag] that maximises
+    // sum(ref[i] * target[i + lag]) over numSamples, then a parabolic fit through its neighbours.
+    // target must hold numSamples + lastLag + 1 samples.
+    float refinePeak(const float* ref, const float* target, int numSamples, int firstLag, int lastLag);
+
+    //==============================================================================
+    // correlation[k] = sum(ref[i] * target[i + firstLag + k]) over the numSamples - (firstLag + k)
+    // samples that overlap, for k in [0, numLags). Lags are taken four at a time, so each
+    // load of ref feeds four accumulators.
+    using CorrelateFunction = void (*)(const float* ref, const float* target, int numSamples, int firstLag, int numLags, float* correlation);
+
+    // Instruction set of the correlate functions, picked once from the CPU this runs on
+    enum class Isa { generic, sse2, avx2, avx512 };
+    Isa getIsa();
+    bool isAvailable(Isa isa);      // Compiled into this build, supported by this CPU and enabled by the OS
+    const char* getIsaName(Isa isa);
+
+    // Looked up once in prepare(). The SIMD instruction sets have kernels specialised on the window
+    // sizes the plugin runs, which only take that numSamples, and one for any other size (windowSize 0).
+    // generic is the per-lag dot product, and the only one on non-x86 builds.
+    CorrelateFunction getCorrelateFunction(Isa isa, int windowSize = 0);
+    bool isSpecialised(Isa isa, int windowSize);
+
+    constexpr float minConfidenceDb = -100.0f;
+    constexpr float maxConfidenceDb = 60.0f;   // Reported when nothing lies outside the main lobe
+}
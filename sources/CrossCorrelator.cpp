@@ -0,0 +1,107 @@
+#include <JuceHeader.h>
+#include "CorrelationKernels.h"
+#include "CrossCorrelator.h"
+
+//==============================================================================
+void CrossCorrelator::prepare(int newMaxNumSamples, int newDecimationFactor)
+{
+    maxNumSamples = juce::jmax(1, newMaxNumSamples);
+    decimationFactor = juce::jmax(1, newDecimationFactor);
+
+    const int maxDecimatedSamples = maxNumSamples / decimationFactor + 1;
+    refDecimated.allocate(static_cast<size_t>(maxDecimatedSamples), true);
+    targetDecimated.allocate(static_cast<size_t>(maxDecimatedSamples), true);
+    correlation.allocate(static_cast<size_t>(maxNumSamples), true);
+
+    const auto isa = CorrelationKernels::getIsa();
+    correlateCoarse = CorrelationKernels::getCorrelateFunction(isa, maxNumSamples / decimationFactor);
+    correlateFine = CorrelationKernels::getCorrelateFunction(isa, maxNumSamples);
+    correlateAnySize = CorrelationKernels::getCorrelateFunction(isa);
+}
+
+void CrossCorrelator::reset()
+{
+    const int maxDecimatedSamples = maxNumSamples / decimationFactor + 1;
+    if (maxNumSamples > 0)
+    {
+        juce::FloatVectorOperations::clear(refDecimated, maxDecimatedSamples);
+        juce::FloatVectorOperations::clear(targetDecimated, maxDecimatedSamples);
+    }
+
+    confidence = CorrelationKernels::minConfidenceDb;
+}
+
+//==============================================================================
+void CrossCorrelator::decimate(const float* source, float* destination, int numSamples) const
+{
+    // Box-filter average over each group: a cheap anti-alias for the coarse pass
+    const float gain = 1.0f / static_cast<float>(decimationFactor);
+    const int numDecimated = numSamples / decimationFactor;
+
+    for (int i = 0; i < numDecimated; ++i)
+    {
+        const float* group = source + i * decimationFactor;
+        float sum = 0.0f;
+        for (int j = 0; j < decimationFactor; ++j)
+            sum += group[j];
+        destination[i] = sum * gain;
+    }
+}
+
+float CrossCorrelator::estimateDelay(const float* ref, const float* target, int numSamples, int maxLagSamples)
+{
+    jassert(maxNumSamples > 0); // prepare() must be called first
+    numSamples = juce::jmin(numSamples, maxNumSamples);
+    maxLagSamples = juce::jlimit(0, numSamples - 1, maxLagSamples);
+
+    confidence = CorrelationKernels::minConfidenceDb;
+    if (numSamples <= 0)
+        return 0.0f;
+
+    // Coarse pass over decimated signals: correlate every lag, then find the peak
+    int coarseLag = 0;
+    if (decimationFactor > 1)
+    {
+        const int numDecimated = numSamples / decimationFactor;
+        const int maxDecimatedLag = juce::jmin(maxLagSamples / decimationFactor, numDecimated - 1);
+        decimate(ref, refDecimated, numSamples);
+        decimate(target, targetDecimated, numSamples);
+
+        const auto correlate = numDecimated == maxNumSamples / decimationFactor ? correlateCoarse : correlateAnySize;
+        correlate(refDecimated, targetDecimated, numDecimated, 0, maxDecimatedLag + 1, correlation);
+        const int peak = static_cast<int>(std::max_element(correlation.get(), correlation + maxDecimatedLag + 1) - correlation.get());
+        coarseLag = peak * decimationFactor;
+
+        confidence = CorrelationKernels::peakToSidelobeRatio(correlation, maxDecimatedLag + 1, peak);
+    }
+
+    // Fine pass at full rate around the coarse peak, one lag wider on each side for the parabolic fit
+    const int fineStart = decimationFactor > 1 ? juce::jmax(0, coarseLag - decimationFactor) : 0;
+    const int fineEnd = decimationFactor > 1 ? juce::jmin(maxLagSamples, coarseLag + decimationFactor) : maxLagSamples;
+    const int firstLag = juce::jmax(0, fineStart - 1);
+    const int lastLag = juce::jmin(maxLagSamples, fineEnd + 1);
+
+    // The coarse correlation has been used up, so lag firstLag + k of the fine pass goes to index k
+    const auto correlate = numSamples == maxNumSamples ? correlateFine : correlateAnySize;
+    correlate(ref, target, numSamples, firstLag, lastLag - firstLag + 1, correlation);
+    const float* search = correlation + (fineStart - firstLag);
+    const int bestLag = fineStart + static_cast<int>(std::max_element(search, search + (fineEnd - fineStart + 1)) - search);
+    const float bestCorrelation = correlation[bestLag - firstLag];
+
+    if (decimationFactor == 1)
+        confidence = CorrelationKernels::peakToSidelobeRatio(correlation, maxLagSamples + 1, bestLag);
+
+    // Parabolic interpolation through the peak and its neighbours
+    if (bestLag <= 0 || bestLag >= maxLagSamples)
+        return static_cast<float>(bestLag);
+
+    const float left = correlation[bestLag - 1 - firstLag];
+    const float right = correlation[bestLag + 1 - firstLag];
+    const float curvature = left - 2.0f * bestCorrelation + right;
+
+    if (curvature >= 0.0f)
+        return static_cast<float>(bestLag); // not a maximum, nothing to refine
+
+    const float offset = juce::jlimit(-0.5f, 0.5f, 0.5f * (left - right) / curvature);
+    return static_cast<float>(bestLag) + offset;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "CorrelationKernels.h"
+
+//==============================================================================
+// Coarse-to-fine time-domain lag search.
+// The coarse pass correlates signals decimated by decimationFactor over the whole lag
+// range. The fine pass correlates at full rate only within one coarse step of the coarse
+// peak. The peak is then refined by parabolic interpolation, so the result is fractional.
+// Both passes correlate through the CorrelationKernels functions for this CPU's instruction
+// set, looked up in prepare(): kernels specialised on the prepared window and on its decimated
+// length, and the instruction set's any-size kernel for shorter windows.
+class CrossCorrelator
+{
+public:
+    //==============================================================================
+    CrossCorrelator() = default;
+
+    void prepare(int maxNumSamples, int decimationFactor);
+    void reset();
+
+    // Lag convention of CorrelationKernels.h
+    float estimateDelay(const float* ref, const float* target, int numSamples, int maxLagSamples);
+
+    int getDecimationFactor() const { return decimationFactor; }
+
+    // Peak-to-sidelobe ratio of the last estimate in dB, measured on the pass that covered every lag
+    float getConfidence() const { return confidence; }
+
+private:
+    //==============================================================================
+    void decimate(const float* source, float* destination, int numSamples) const;
+
+    juce::HeapBlock<float> refDecimated;
+    juce::HeapBlock<float> targetDecimated;
+    juce::HeapBlock<float> correlation;     // one value per lag of the full-range pass
+    CorrelationKernels::CorrelateFunction correlateCoarse = nullptr;    // Coarse pass over a whole prepared window
+    CorrelationKernels::CorrelateFunction correlateFine = nullptr;      // Fine pass over a whole prepared window
+    CorrelationKernels::CorrelateFunction correlateAnySize = nullptr;   // Either pass over a shorter window
+    int maxNumSamples = 0;
+    int decimationFactor = 1;
+    float confidence = CorrelationKernels::minConfidenceDb;
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CrossCorrelator)
+};
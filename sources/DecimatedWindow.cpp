@@ -0,0 +1,60 @@
+#include <JuceHeader.h>
+#include "DecimatedWindow.h"
+
+//==============================================================================
+void DecimatedWindow::prepare(int factor, int fullRateWindowSize, int maxNumTargets)
+{
+    const int numChannels = 1 + juce::jmax(1, maxNumTargets);
+    decimator.prepare(factor, numChannels);
+
+    windowSize = juce::jmax(1, fullRateWindowSize / decimator.getFactor());
+    chunkSize = 64 * decimator.getFactor();
+    rings.clear();
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        rings.push_back(std::make_unique<MirroredRingBuffer>());
+        rings.back()->allocate(windowSize);
+    }
+    chunk.setSize(numChannels, chunkSize / decimator.getFactor() + 1);
+    chunkInputs.allocate(static_cast<size_t>(numChannels), true);
+    chunkOutputs.allocate(static_cast<size_t>(numChannels), true);
+
+    reset();
+}
+
+void DecimatedWindow::reset()
+{
+    decimator.reset();
+    for (auto& ring : rings)
+        ring->clear();
+    fill = 0;
+}
+
+//==============================================================================
+void DecimatedWindow::pushSamples(const float* ref, const float* const* targets, int numTargets, int numSamples)
+{
+    // A different set of targets leaves the other channels stale
+    numTargets = juce::jlimit(1, static_cast<int>(rings.size()) - 1, numTargets);
+    if (numTargets != numActiveTargets)
+    {
+        reset();
+        numActiveTargets = numTargets;
+    }
+
+    const int numChannels = 1 + numActiveTargets;
+    for (int channel = 0; channel < numChannels; ++channel)
+        chunkOutputs[channel] = chunk.getWritePointer(channel);
+
+    for (int offset = 0; offset < numSamples; offset += chunkSize)
+    {
+        chunkInputs[0] = ref + offset;
+        for (int t = 0; t < numActiveTargets; ++t)
+            chunkInputs[1 + t] = targets[t] + offset;
+
+        const int numDecimated = decimator.process(chunkInputs, chunkOutputs, numChannels, juce::jmin(chunkSize, numSamples - offset));
+        for (int channel = 0; channel < numChannels; ++channel)
+            rings[static_cast<size_t>(channel)]->write(chunk.getReadPointer(channel), numDecimated);
+
+        fill = juce::jmin(fill + numDecimated, windowSize);
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "MirroredRingBuffer.h"
+#include "PolyphaseDecimator.h"
+
+//==============================================================================
+// The newest analysis window of a reference and its targets, streamed through a
+// PolyphaseDecimator. It spans as much time as a full-rate window of
+// fullRateWindowSize samples, in fullRateWindowSize / factor samples. The estimators
+// can then search it at a fraction of the cost. Every channel is a MirroredRingBuffer,
+// so it reads oldest-first and contiguous.
+class DecimatedWindow
+{
+public:
+    //==============================================================================
+    DecimatedWindow() = default;
+
+    void prepare(int factor, int fullRateWindowSize, int maxNumTargets);
+    void reset();
+
+    void pushSamples(const float* ref, const float* const* targets, int numTargets, int numSamples);
+
+    // Channel 0 is the reference, channels 1 .. numTargets the targets
+    const float* getReadPointer(int channel) const { return rings[static_cast<size_t>(channel)]->getNewest(windowSize); }
+    int getNumSamples() const { return windowSize; }
+    int getFactor() const { return decimator.getFactor(); }
+
+    // Every sample of the window arrived since the last reset
+    bool isFull() const { return fill == windowSize; }
+
+private:
+    //==============================================================================
+    PolyphaseDecimator decimator;
+    std::vector<std::unique_ptr<MirroredRingBuffer>> rings;    // Reference, then one per target
+    juce::AudioBuffer<float> chunk;             // Decimator output for one chunk of input
+    juce::HeapBlock<const float*> chunkInputs;
+    juce::HeapBlock<float*> chunkOutputs;
+    int windowSize = 1;
+    int chunkSize = 1;                          // Full-rate samples decimated per pass
+    int fill = 0;
+    int numActiveTargets = 1;
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DecimatedWindow)
+};
@@ -0,0 +1,145 @@
+#include <JuceHeader.h>
+#include "DelayTracker.h"
+
+//==============================================================================
+void DelayTracker::prepare(double newSampleRate, float toleranceSamples, double lockSeconds)
+{
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+    tolerance = juce::jmax(0.0f, toleranceSamples);
+    lockSamples = static_cast<juce::int64>(lockSeconds * sampleRate);
+    reset();
+}
+
+void DelayTracker::reset()
+{
+    delay = drift = 0.0;
+    p00 = p01 = p11 = 0.0;
+    tracking = false;
+    trackedSamples = 0;
+    numOutliers = 0;
+    lastOutlier = 0.0;
+    lastMeasurement = -1;
+}
+
+bool DelayTracker::isLocked() const
+{
+    return tracking && numOutliers == 0 && trackedSamples >= lockSamples && std::sqrt(p00) <= tolerance;
+}
+
+//==============================================================================
+void DelayTracker::predict(juce::int64 elapsedSamples)
+{
+    if (! tracking || elapsedSamples <= 0)
+        return;
+
+    trackedSamples += elapsedSamples;
+    const double dt = static_cast<double>(elapsedSamples) / sampleRate;
+
+    // Constant-drift model: x' = F x with F = [1 dt; 0 1], P' = F P F^T + Q
+    delay += drift * dt;
+    p00 += dt * (2.0 * p01 + dt * p11);
+    p01 += dt * p11;
+
+    // Random walks on the delay and on the drift (white acceleration noise)
+    const double q = static_cast<double>(responsiveness);
+    p00 += q * (delayNoise * dt + driftNoise * dt * dt * dt / 3.0);
+    p01 += q * driftNoise * dt * dt / 2.0;
+    p11 += q * driftNoise * dt;
+}
+
+bool DelayTracker::update(float measuredDelay, float confidenceDb, juce::int64 measurement)
+{
+    if (measurement == lastMeasurement)
+        return false;
+
+    lastMeasurement = measurement;
+    const double z = static_cast<double>(measuredDelay);
+    const double r = getMeasurementVariance(confidenceDb);
+
+    if (! tracking)
+    {
+        restart(z, r);
+        return true;
+    }
+
+    const double innovation = z - delay;
+    const double s = p00 + r;
+
+    if (innovation * innovation > gateSigmas * gateSigmas * s)
+    {
+        // A lone outlier is ignored; several that agree mean the delay has moved
+        const bool agrees = numOutliers > 0 && std::abs(z - lastOutlier) <= gateSigmas * std::sqrt(2.0 * r);
+        numOutliers = agrees ? numOutliers + 1 : 1;
+        lastOutlier = z;
+
+        if (numOutliers < outliersToRestart)
+            return false;
+
+        restart(z, r);
+        return true;
+    }
+
+    numOutliers = 0;
+
+    // Kalman gain for a measurement of the delay alone, H = [1 0]
+    const double k0 = p00 / s;
+    const double k1 = p01 / s;
+    delay += k0 * innovation;
+    drift += k1 * innovation;
+
+    // P = (I - K H) P, written out so it stays symmetric
+    const double newP00 = (1.0 - k0) * p00;
+    const double newP01 = (1.0 - k0) * p01;
+    const double newP11 = p11 - k1 * p01;
+    p00 = newP00;
+    p01 = newP01;
+    p11 = newP11;
+    return true;
+}
+
+//==============================================================================
+DelayTracker::State DelayTracker::getState() const
+{
+    State state;
+    state.tracking = tracking;
+    state.locked = isLocked();
+    state.delay = delay;
+    state.drift = drift;
+    state.p00 = p00;
+    state.p01 = p01;
+    state.p11 = p11;
+    return state;
+}
+
+void DelayTracker::setState(const State& state)
+{
+    reset();
+    if (! state.tracking || state.p00 < 0.0 || state.p11 < 0.0)
+        return;
+
+    tracking = true;
+    delay = state.delay;
+    drift = state.drift;
+    p00 = state.p00;
+    p01 = state.p01;
+    p11 = state.p11;
+    trackedSamples = state.locked ? lockSamples : 0;
+}
+
+void DelayTracker::restart(double measuredDelay, double variance)
+{
+    delay = measuredDelay;
+    drift = 0.0;
+    p00 = variance;
+    p01 = 0.0;
+    p11 = initialDriftVariance;
+    tracking = true;
+    trackedSamples = 0;
+    numOutliers = 0;
+}
+
+double DelayTracker::getMeasurementVariance(float confidenceDb)
+{
+    // Every 10 dB of peak-to-sidelobe ratio trusts the estimate ten times more
+    return juce::jmax(minVariance, varianceAt0Db * std::pow(10.0, -static_cast<double>(confidenceDb) / 10.0));
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+//==============================================================================
+// Two-state Kalman filter, delay and drift, that turns raw delay estimates into
+// the delay to apply.
+//
+// Every estimate is weighted by its peak-to-sidelobe confidence: a sharp peak
+// pulls the track hard, a marginal one barely moves it. Between estimates the
+// track is predicted forward with its drift, and its uncertainty grows with the
+// time that passed. An estimate far outside the predicted uncertainty is held back
+// as an outlier. A few outliers in a row that agree with each other mean the delay
+// really moved, so the track restarts there.
+//
+// Estimators hop through the stream, and every estimate between two hops sees the
+// same audio. Each estimate therefore comes with the index of the measurement it
+// belongs to, and only the first estimate of a measurement is fused: the same audio
+// counted twice would shrink the uncertainty on no new evidence.
+//
+// The track is locked once the delay's standard deviation is within the tolerance
+// and it has run for lockSeconds of analysed audio without outliers. A locked
+// track needs estimates only now and then.
+class DelayTracker
+{
+public:
+    //==============================================================================
+    DelayTracker() = default;
+
+    void prepare(double sampleRate, float toleranceSamples, double lockSeconds);
+    void reset();
+
+    // How fast the track follows: scales the process noise. 1 is the default, 0 freezes
+    // the delay once the track has one.
+    void setResponsiveness(float newResponsiveness) { responsiveness = juce::jmax(0.0f, newResponsiveness); }
+
+    // Moves the track forward by the audio analysed since the last call
+    void predict(juce::int64 elapsedSamples);
+
+    // Fuses one estimate of the given measurement. False if that measurement was already
+    // fused, or the estimate was held back as an outlier.
+    bool update(float measuredDelay, float confidenceDb, juce::int64 measurement);
+
+    bool hasTrack() const { return tracking; }
+    bool isLocked() const;
+    float getDelay() const { return static_cast<float>(delay); }
+    float getDrift() const { return static_cast<float>(drift); }                  // Samples per second
+    float getUncertainty() const { return static_cast<float>(std::sqrt(p00)); }    // Standard deviation in samples
+
+    //==============================================================================
+    // Everything needed to pick a track up again, in the same units as the getters
+    struct State
+    {
+        bool tracking = false;
+        bool locked = false;
+        double delay = 0.0;
+        double drift = 0.0;
+        double p00 = 0.0;
+        double p01 = 0.0;
+        double p11 = 0.0;
+    };
+
+    State getState() const;
+
+    // A track that was locked stays locked, without running for lockSeconds again
+    void setState(const State& state);
+
+private:
+    //==============================================================================
+    void restart(double measuredDelay, double variance);
+    static double getMeasurementVariance(float confidenceDb);
+
+    double sampleRate = 44100.0;
+    float tolerance = 1.0f;
+    juce::int64 lockSamples = 0;
+    float responsiveness = 1.0f;
+    double delay = 0.0;             // State: samples
+    double drift = 0.0;             // State: samples per second
+    double p00 = 0.0;               // Covariance of delay and drift
+    double p01 = 0.0;
+    double p11 = 0.0;
+    bool tracking = false;
+    juce::int64 trackedSamples = 0; // Analysed since the track (re)started
+    int numOutliers = 0;            // In a row
+    double lastOutlier = 0.0;
+    juce::int64 lastMeasurement = -1;   // Index of the last measurement fused or held back
+    static constexpr double delayNoise = 0.05;          // Random walk of the delay, samples^2 per second
+    static constexpr double driftNoise = 0.01;          // Random walk of the drift, (samples per second)^2 per second
+    static constexpr double initialDriftVariance = 1.0; // (Samples per second)^2 when a track starts
+    static constexpr double varianceAt0Db = 16.0;       // Samples^2 of an estimate whose peak is level with its sidelobes
+    static constexpr double minVariance = 1.0e-4;
+    static constexpr double gateSigmas = 4.0;           // Outlier threshold on the innovation
+    static constexpr int outliersToRestart = 3;
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DelayTracker)
+};
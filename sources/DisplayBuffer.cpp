@@ -0,0 +1,248 @@
+#include <JuceHeader.h>
+#include "DisplayBuffer.h"
+
+//==============================================================================
+void DisplayBuffer::prepare(int numChannels, int capacityInSamples)
+{
+    storage.setSize(numChannels, juce::jmax(1, capacityInSamples));
+    storage.clear();
+
+    // Size every pyramid level for the full capacity
+    levelOffsets.clear();
+    int numBuckets = (storage.getNumSamples() + baseBucketSize - 1) / baseBucketSize;
+    int totalBuckets = 0;
+    for (;;)
+    {
+        levelOffsets.push_back(totalBuckets);
+        totalBuckets += numBuckets;
+        if (numBuckets == 1)
+            break;
+        numBuckets = (numBuckets + 1) / 2;
+    }
+
+    pyramidMin.setSize(numChannels, totalBuckets);
+    pyramidMax.setSize(numChannels, totalBuckets);
+    pyramidMin.clear();
+    pyramidMax.clear();
+
+    logicalLength.store(storage.getNumSamples(), std::memory_order_relaxed);
+    writePlayheadIndex.store(0, std::memory_order_relaxed);
+    writeEndIndex.store(0, std::memory_order_relaxed);
+    totalWritten.store(0, std::memory_order_relaxed);
+    generation.store(0, std::memory_order_relaxed);
+    sequence.store(0, std::memory_order_release);
+}
+
+void DisplayBuffer::setLength(int newLength)
+{
+    // No reallocation and no clear: stale samples are overwritten within one beat
+    const auto start = sequence.load(std::memory_order_relaxed);
+    sequence.store(start + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    logicalLength.store(juce::jlimit(1, storage.getNumSamples(), newLength), std::memory_order_relaxed);
+    writePlayheadIndex.store(0, std::memory_order_relaxed);
+    writeEndIndex.store(0, std::memory_order_relaxed);
+    totalWritten.store(0, std::memory_order_relaxed);
+    generation.store(generation.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    sequence.store(start + 2, std::memory_order_release);
+}
+
+void DisplayBuffer::writeBlock(const float* const* sources, int numSources, int startIndex, int numSamples)
+{
+    const int length = getLength();
+    if (numSamples <= 0 || length <= 0)
+        return;
+
+    // Only the most recent `length` samples can be visible
+    int sourceOffset = 0;
+    if (numSamples > length)
+    {
+        sourceOffset = numSamples - length;
+        startIndex += sourceOffset;
+        numSamples = length;
+    }
+    startIndex %= length;
+
+    const auto start = sequence.load(std::memory_order_relaxed);
+    sequence.store(start + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const int firstChunk = juce::jmin(numSamples, length - startIndex);
+    const int secondChunk = numSamples - firstChunk;
+    const int numChannels = juce::jmin(numSources, storage.getNumChannels());
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        if (sources[ch] == nullptr)
+            continue;
+
+        storage.copyFrom(ch, startIndex, sources[ch] + sourceOffset, firstChunk);
+        if (secondChunk > 0)
+            storage.copyFrom(ch, 0, sources[ch] + sourceOffset + firstChunk, secondChunk);
+    }
+
+    updatePyramid(startIndex, firstChunk);
+    if (secondChunk > 0)
+        updatePyramid(0, secondChunk);
+
+    writePlayheadIndex.store(startIndex, std::memory_order_relaxed);
+    writeEndIndex.store((startIndex + numSamples) % length, std::memory_order_relaxed);
+    totalWritten.store(totalWritten.load(std::memory_order_relaxed) + numSamples, std::memory_order_relaxed);
+
+    sequence.store(start + 2, std::memory_order_release);
+}
+
+void DisplayBuffer::updatePyramid(int startIndex, int numSamples)
+{
+    // Recompute only the buckets touched by [startIndex, startIndex + numSamples), level by level
+    const int length = getLength();
+    int firstBucket = startIndex / baseBucketSize;
+    int lastBucket = (startIndex + numSamples - 1) / baseBucketSize;
+    int numBuckets = (length + baseBucketSize - 1) / baseBucketSize;
+
+    for (int ch = 0; ch < storage.getNumChannels(); ++ch)
+    {
+        const float* samples = storage.getReadPointer(ch);
+        float* mins = pyramidMin.getWritePointer(ch);
+        float* maxs = pyramidMax.getWritePointer(ch);
+
+        for (int bucket = firstBucket; bucket <= lastBucket; ++bucket)
+        {
+            const int bucketStart = bucket * baseBucketSize;
+            const int bucketSize = juce::jmin(baseBucketSize, length - bucketStart);
+            const auto range = juce::FloatVectorOperations::findMinAndMax(samples + bucketStart, bucketSize);
+            mins[bucket] = range.getStart();
+            maxs[bucket] = range.getEnd();
+        }
+    }
+
+    for (size_t level = 1; level < levelOffsets.size() && numBuckets > 1; ++level)
+    {
+        const int childOffset = levelOffsets[level - 1];
+        const int offset = levelOffsets[level];
+        const int numChildBuckets = numBuckets;
+        firstBucket /= 2;
+        lastBucket /= 2;
+        numBuckets = (numBuckets + 1) / 2;
+
+        for (int ch = 0; ch < storage.getNumChannels(); ++ch)
+        {
+            float* mins = pyramidMin.getWritePointer(ch);
+            float* maxs = pyramidMax.getWritePointer(ch);
+
+            for (int bucket = firstBucket; bucket <= lastBucket; ++bucket)
+            {
+                const int left = childOffset + 2 * bucket;
+                const bool hasRight = 2 * bucket + 1 < numChildBuckets;
+                mins[offset + bucket] = hasRight ? juce::jmin(mins[left], mins[left + 1]) : mins[left];
+                maxs[offset + bucket] = hasRight ? juce::jmax(maxs[left], maxs[left + 1]) : maxs[left];
+            }
+        }
+    }
+}
+
+//==============================================================================
+void DisplayBuffer::loadFrameState(FrameState& state) const
+{
+    state.length = logicalLength.load(std::memory_order_relaxed);
+    state.playheadIndex = writePlayheadIndex.load(std::memory_order_relaxed);
+    state.writeEndIndex = writeEndIndex.load(std::memory_order_relaxed);
+    state.totalWritten = totalWritten.load(std::memory_order_relaxed);
+    state.generation = generation.load(std::memory_order_relaxed);
+}
+
+bool DisplayBuffer::readFrameState(FrameState& state) const
+{
+    for (int attempt = 0; attempt < maxReadAttempts; ++attempt)
+    {
+        const auto before = sequence.load(std::memory_order_acquire);
+        if ((before & 1u) != 0)
+        {
+            juce::Thread::yield(); // a write is in progress
+            continue;
+        }
+
+        loadFrameState(state);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before)
+            return true;
+    }
+
+    return false;
+}
+
+void DisplayBuffer::computeColumn(int channel, juce::int64 start, juce::int64 end, int level, float& min, float& max) const
+{
+    if (level < 0)
+    {
+        // Fewer samples per column than a level-0 bucket: read the samples directly
+        const auto range = juce::FloatVectorOperations::findMinAndMax(storage.getReadPointer(channel, static_cast<int>(start)),
+                                                                       static_cast<int>(end - start));
+        min = range.getStart();
+        max = range.getEnd();
+        return;
+    }
+
+    const int bucketSize = baseBucketSize << level;
+    const int firstBucket = static_cast<int>(start / bucketSize);
+    const int lastBucket = static_cast<int>((end - 1) / bucketSize);
+    const float* mins = pyramidMin.getReadPointer(channel, levelOffsets[static_cast<size_t>(level)]);
+    const float* maxs = pyramidMax.getReadPointer(channel, levelOffsets[static_cast<size_t>(level)]);
+
+    min = mins[firstBucket];
+    max = maxs[firstBucket];
+    for (int bucket = firstBucket + 1; bucket <= lastBucket; ++bucket)
+    {
+        min = juce::jmin(min, mins[bucket]);
+        max = juce::jmax(max, maxs[bucket]);
+    }
+}
+
+bool DisplayBuffer::readColumns(int numColumns, int firstColumn, int numColumnsToRead,
+                                float* const* mins, float* const* maxs, FrameState& state) const
+{
+    if (numColumns <= 0)
+        return false;
+
+    firstColumn = juce::jlimit(0, numColumns, firstColumn);
+    numColumnsToRead = juce::jlimit(0, numColumns - firstColumn, numColumnsToRead);
+
+    for (int attempt = 0; attempt < maxReadAttempts; ++attempt)
+    {
+        const auto before = sequence.load(std::memory_order_acquire);
+        if ((before & 1u) != 0)
+        {
+            juce::Thread::yield(); // a write is in progress
+            continue;
+        }
+
+        loadFrameState(state);
+        const juce::int64 length = state.length;
+
+        // Coarsest level whose buckets are no wider than one column
+        int level = -1;
+        const juce::int64 samplesPerColumn = length / numColumns;
+        while (level + 1 < static_cast<int>(levelOffsets.size())
+               && (static_cast<juce::int64>(baseBucketSize) << (level + 1)) <= samplesPerColumn)
+            ++level;
+
+        for (int ch = 0; ch < storage.getNumChannels(); ++ch)
+        {
+            for (int column = firstColumn; column < firstColumn + numColumnsToRead; ++column)
+            {
+                const juce::int64 start = column * length / numColumns;
+                const juce::int64 end = juce::jmax(start + 1, (column + 1) * length / numColumns);
+                computeColumn(ch, start, end, level, mins[ch][column], maxs[ch][column]);
+            }
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before)
+            return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+//==============================================================================
+// One beat of waveform history shared between the audio thread (single writer) and
+// the editor (reader).
+// Storage is allocated once in prepare() for the slowest supported tempo. A tempo
+// change only moves the logical length. The handoff is a seqlock: the writer never
+// blocks or allocates, and the reader retries until it gets a frame that no write
+// overlapped.
+//
+// The writer also keeps a min/max pyramid of the samples it writes. Level 0 holds
+// buckets of baseBucketSize samples, and each level above halves the bucket count.
+// Readers ask for pixel columns and get them from the coarsest level that still
+// resolves one column, so the read cost does not depend on the tempo.
+class DisplayBuffer
+{
+public:
+    //==============================================================================
+    DisplayBuffer() = default;
+
+    // Message thread, while the audio thread is stopped
+    void prepare(int numChannels, int capacityInSamples);
+
+    //==============================================================================
+    // Audio thread
+    void setLength(int newLength);
+    void writeBlock(const float* const* sources, int numSources, int startIndex, int numSamples);
+
+    int getLength() const { return logicalLength.load(std::memory_order_relaxed); }
+    int getCapacity() const { return storage.getNumSamples(); }
+    int getNumChannels() const { return storage.getNumChannels(); }
+
+    //==============================================================================
+    // Everything the reader needs to know about the frame it read
+    struct FrameState
+    {
+        int length = 0;
+        int playheadIndex = 0;          // start of the most recent block
+        int writeEndIndex = 0;          // one past the end of the most recent block
+        juce::int64 totalWritten = 0;   // samples written since the last setLength()
+        juce::uint32 generation = 0;    // bumped by setLength()
+    };
+
+    // Any other thread. Both return false if every attempt overlapped a write; the outputs are then unspecified.
+    bool readFrameState(FrameState& state) const;
+
+    // Min/max of columns [firstColumn, firstColumn + numColumnsToRead) out of numColumns spanning the beat.
+    // mins[ch][column] / maxs[ch][column] are written for every channel.
+    bool readColumns(int numColumns, int firstColumn, int numColumnsToRead,
+                     float* const* mins, float* const* maxs, FrameState& state) const;
+
+private:
+    //==============================================================================
+    void updatePyramid(int startIndex, int numSamples);
+    void computeColumn(int channel, juce::int64 start, juce::int64 end, int level, float& min, float& max) const;
+    void loadFrameState(FrameState& state) const;
+
+    juce::AudioBuffer<float> storage;
+    juce::AudioBuffer<float> pyramidMin;    // per channel: all levels back to back
+    juce::AudioBuffer<float> pyramidMax;
+    std::vector<int> levelOffsets;          // start of each level in the pyramid buffers
+    std::atomic<juce::uint32> sequence { 0 };   // odd while a write is in progress
+    std::atomic<int> logicalLength { 0 };
+    std::atomic<int> writePlayheadIndex { 0 };
+    std::atomic<int> writeEndIndex { 0 };
+    std::atomic<juce::int64> totalWritten { 0 };
+    std::atomic<juce::uint32> generation { 0 };
+    static constexpr int baseBucketSize = 16;
+    static constexpr int maxReadAttempts = 8;
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DisplayBuffer)
+};
@@ -0,0 +1,169 @@
+#include <JuceHeader.h>
+#include "FractionalDelayLine.h"
+
+//==============================================================================
+void FractionalDelayLine::prepare(int numChannels, int maxDelaySamples, int maxBlockSize, int crossfadeSamples)
+{
+    maxDelay = juce::jmax(0, maxDelaySamples);
+    maxBlock = juce::jmax(1, maxBlockSize);
+    crossfadeLength = juce::jmax(1, crossfadeSamples);
+
+    // Room for the longest delay, the three extra Lagrange taps and one block written ahead of the read
+    rings.clear();
+    for (int ch = 0; ch < juce::jmax(1, numChannels); ++ch)
+    {
+        rings.push_back(std::make_unique<MirroredRingBuffer>());
+        rings.back()->allocate(maxDelay + 4 + maxBlock);
+    }
+    blockChannels.allocate(rings.size(), true);
+
+    tapA.allocate(static_cast<size_t>(maxBlock), true);
+    tapB.allocate(static_cast<size_t>(maxBlock), true);
+    fadeRamp.allocate(static_cast<size_t>(crossfadeLength), true);
+    for (int i = 0; i < crossfadeLength; ++i)
+        fadeRamp[i] = (static_cast<float>(i) + 0.5f) / static_cast<float>(crossfadeLength);
+
+    reset();
+}
+
+void FractionalDelayLine::reset()
+{
+    clearHistory();
+    currentDelay = targetDelay = requestedDelay = pendingDelay = 0.0f;
+    hasPendingDelay = false;
+    fading = false;
+    fadePosition = 0;
+}
+
+void FractionalDelayLine::clearHistory()
+{
+    for (auto& ring : rings)
+        ring->clear();
+}
+
+void FractionalDelayLine::setDelay(float newDelaySamples)
+{
+    requestedDelay = juce::jlimit(0.0f, static_cast<float>(maxDelay), newDelaySamples);
+
+    if (fading)
+    {
+        pendingDelay = requestedDelay;
+        hasPendingDelay = true;
+    }
+    else if (isDelayChange(requestedDelay, currentDelay))
+    {
+        startFade(requestedDelay);
+    }
+}
+
+void FractionalDelayLine::setCurrentAndTargetDelay(float newDelaySamples)
+{
+    requestedDelay = juce::jlimit(0.0f, static_cast<float>(maxDelay), newDelaySamples);
+    currentDelay = targetDelay = pendingDelay = requestedDelay;
+    hasPendingDelay = false;
+    fading = false;
+    fadePosition = 0;
+}
+
+void FractionalDelayLine::startFade(float newDelay)
+{
+    targetDelay = newDelay;
+    fadePosition = 0;
+    fading = true;
+}
+
+//==============================================================================
+void FractionalDelayLine::write(const float* const* channels, int numChannels, int numSamples)
+{
+    for (int ch = 0; ch < numChannels; ++ch)
+        rings[static_cast<size_t>(ch)]->write(channels[ch], numSamples);
+}
+
+void FractionalDelayLine::renderTap(int channel, float delay, float* destination, int numSamples, int samplesBeforeEnd) const
+{
+    // Same tap layout as juce::dsp::DelayLineInterpolationTypes::Lagrange3rd
+    int delayInt = static_cast<int>(delay);
+    float frac = delay - static_cast<float>(delayInt);
+    if (delayInt >= 1)
+    {
+        frac += 1.0f;
+        --delayInt;
+    }
+
+    const float d1 = frac - 1.0f;
+    const float d2 = frac - 2.0f;
+    const float d3 = frac - 3.0f;
+    const float c0 = -d1 * d2 * d3 / 6.0f;
+    const float c1 = frac * d2 * d3 * 0.5f;
+    const float c2 = frac * -d1 * d3 * 0.5f;
+    const float c3 = frac * d1 * d2 / 6.0f;
+
+    // Sample n of the block is x[n - delayInt - k] for tap k; the oldest of them is 3 samples before tap0
+    const float* tap0 = rings[static_cast<size_t>(channel)]->getNewest(samplesBeforeEnd + delayInt + 3) + 3;
+
+    juce::FloatVectorOperations::multiply(destination, tap0, c0, numSamples);
+    juce::FloatVectorOperations::addWithMultiply(destination, tap0 - 1, c1, numSamples);
+    juce::FloatVectorOperations::addWithMultiply(destination, tap0 - 2, c2, numSamples);
+    juce::FloatVectorOperations::addWithMultiply(destination, tap0 - 3, c3, numSamples);
+}
+
+void FractionalDelayLine::process(float* const* channels, int numChannels, int numSamples)
+{
+    numChannels = juce::jmin(numChannels, static_cast<int>(rings.size()));
+
+    for (int blockStart = 0; blockStart < numSamples; blockStart += maxBlock)
+    {
+        const int blockSize = juce::jmin(maxBlock, numSamples - blockStart);
+        float** block = blockChannels.get();
+        for (int ch = 0; ch < numChannels; ++ch)
+            block[ch] = channels[ch] + blockStart;
+
+        // Write first so a zero delay reads the current block
+        write(block, numChannels, blockSize);
+
+        int offset = 0;
+        while (offset < blockSize)
+        {
+            if (! fading)
+            {
+                for (int ch = 0; ch < numChannels; ++ch)
+                    renderTap(ch, currentDelay, block[ch] + offset, blockSize - offset, blockSize - offset);
+                break;
+            }
+
+            // Linear crossfade: both taps carry the same signal, so equal gain keeps the level constant
+            const int fadeSize = juce::jmin(blockSize - offset, crossfadeLength - fadePosition);
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                renderTap(ch, currentDelay, tapA, fadeSize, blockSize - offset);
+                renderTap(ch, targetDelay, tapB, fadeSize, blockSize - offset);
+                juce::FloatVectorOperations::subtract(tapB, tapA, fadeSize);
+                juce::FloatVectorOperations::multiply(tapB, fadeRamp + fadePosition, fadeSize);
+                juce::FloatVectorOperations::add(block[ch] + offset, tapA, tapB, fadeSize);
+            }
+
+            offset += fadeSize;
+            fadePosition += fadeSize;
+
+            if (fadePosition >= crossfadeLength)
+            {
+                currentDelay = targetDelay;
+                fading = false;
+
+                if (hasPendingDelay)
+                {
+                    hasPendingDelay = false;
+                    if (isDelayChange(pendingDelay, currentDelay))
+                        startFade(pendingDelay);
+                }
+            }
+        }
+    }
+}
+
+const float* FractionalDelayLine::getInput(int channel, int numSamples, int offsetSamples) const
+{
+    // process() writes the input before it renders, so the history still holds it unchanged
+    jassert(numSamples + offsetSamples <= rings[static_cast<size_t>(channel)]->getCapacity());
+    return rings[static_cast<size_t>(channel)]->getNewest(numSamples + offsetSamples);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "MirroredRingBuffer.h"
+
+//==============================================================================
+// Block-processing fractional delay with 3rd-order Lagrange interpolation.
+// Each channel's history is a MirroredRingBuffer, so the samples any tap reads are
+// always contiguous. A whole block is rendered with
+// four vectorised multiply-adds per channel instead of one call per sample.
+//
+// setDelay() does not jump. It crossfades from the current tap to the new tap over
+// crossfadeSamples. A request that arrives mid-fade is queued and starts when the
+// running fade ends. A request within minDelayChange of the current delay is jitter
+// and starts no fade.
+class FractionalDelayLine
+{
+public:
+    //==============================================================================
+    FractionalDelayLine() = default;
+
+    void prepare(int numChannels, int maxDelaySamples, int maxBlockSize, int crossfadeSamples);
+    void reset();
+
+    // Silences the history and keeps the delay, for when the channels change meaning
+    void clearHistory();
+
+    // In place; numSamples may exceed the prepared block size
+    void process(float* const* channels, int numChannels, int numSamples);
+
+    // The input of the last process() call as it arrived, undelayed, but offsetSamples later:
+    // numSamples contiguous samples, valid until the next call. Needs numSamples + offsetSamples
+    // within the prepared maximum delay plus one block.
+    const float* getInput(int channel, int numSamples, int offsetSamples) const;
+
+    void setDelay(float newDelaySamples);
+
+    // Jumps straight to the delay and drops any fade; only for before anything has been output
+    void setCurrentAndTargetDelay(float newDelaySamples);
+    float getDelay() const { return requestedDelay; }
+    int getMaximumDelayInSamples() const { return maxDelay; }
+    int getNumChannels() const { return static_cast<int>(rings.size()); }
+    bool isCrossfading() const { return fading; }
+
+private:
+    //==============================================================================
+    void write(const float* const* channels, int numChannels, int numSamples);
+    void renderTap(int channel, float delay, float* destination, int numSamples, int samplesBeforeEnd) const;
+    void startFade(float newDelay);
+    static bool isDelayChange(float a, float b) { return std::abs(a - b) > minDelayChange; }
+
+    std::vector<std::unique_ptr<MirroredRingBuffer>> rings;   // One per channel
+    juce::HeapBlock<float> fadeRamp;    // crossfadeLength gains rising from 0 to 1
+    juce::HeapBlock<float> tapA;        // maxBlockSize, outgoing tap during a fade
+    juce::HeapBlock<float> tapB;        // maxBlockSize, incoming tap during a fade
+    juce::HeapBlock<float*> blockChannels;  // per-channel pointers into the sub-block being processed
+    int maxDelay = 0;
+    int maxBlock = 0;
+    int crossfadeLength = 1;
+    float currentDelay = 0.0f;
+    float targetDelay = 0.0f;
+    float requestedDelay = 0.0f;
+    float pendingDelay = 0.0f;
+    bool hasPendingDelay = false;
+    bool fading = false;
+    int fadePosition = 0;
+    static constexpr float minDelayChange = 1.0e-3f;   // Samples
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FractionalDelayLine)
+};
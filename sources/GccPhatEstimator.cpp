@@ -0,0 +1,308 @@
+#include <JuceHeader.h>
+#include "CorrelationKernels.h"
+#include "GccPhatEstimator.h"
+
+//==============================================================================
+void GccPhatEstimator::prepare(int newMaxNumSamples, int newMaxNumTargets)
+{
+    maxNumSamples = juce::jmax(1, newMaxNumSamples);
+    maxNumTargets = juce::jmax(1, newMaxNumTargets);
+    numActiveTargets = 1;
+    hopSize = juce::jmax(1, maxNumSamples / 2);
+
+    // Zero-pad to at least twice the window so the correlation is linear, not circular
+    const int fftOrder = juce::findHighestSetBit(static_cast<juce::uint32>(juce::nextPowerOfTwo(2 * maxNumSamples)));
+    fft = std::make_unique<juce::dsp::FFT>(fftOrder);
+    fftSize = fft->getSize();
+
+    // Real-only transforms need 2 * fftSize floats of working space
+    refSpectrum.allocate(static_cast<size_t>(2 * fftSize), true);
+    targetSpectrum.allocate(static_cast<size_t>(2 * fftSize), true);
+    accumulatedSpectrum.allocate(static_cast<size_t>(maxNumTargets * (fftSize + 2)), true);
+    segmentRef.allocate(static_cast<size_t>(maxNumSamples), true);
+    segmentTargets.allocate(static_cast<size_t>(maxNumTargets * maxNumSamples), true);
+    accumulatedLags.allocate(static_cast<size_t>(maxNumTargets), true);
+    accumulatedLagIsStale.allocate(static_cast<size_t>(maxNumTargets), true);
+    accumulatedConfidences.allocate(static_cast<size_t>(maxNumTargets), true);
+    confidences.allocate(static_cast<size_t>(maxNumTargets), true);
+
+    segmentCount = 0;
+    resetAccumulator();
+}
+
+void GccPhatEstimator::reset()
+{
+    if (fftSize > 0)
+    {
+        juce::FloatVectorOperations::clear(refSpectrum, 2 * fftSize);
+        juce::FloatVectorOperations::clear(targetSpectrum, 2 * fftSize);
+    }
+
+    resetAccumulator();
+}
+
+void GccPhatEstimator::resetAccumulator()
+{
+    if (fftSize > 0)
+    {
+        juce::FloatVectorOperations::clear(accumulatedSpectrum, maxNumTargets * (fftSize + 2));
+        for (int t = 0; t < maxNumTargets; ++t)
+        {
+            accumulatedLagIsStale[t] = true;
+            confidences[t] = CorrelationKernels::minConfidenceDb;
+        }
+    }
+
+    segmentFill = 0;
+    numSegmentsAccumulated = 0;
+}
+
+//==============================================================================
+void GccPhatEstimator::computeReferenceSpectrum(const float* ref, int numSamples)
+{
+    // Zero-padded forward transform (bins 0 .. fftSize / 2, interleaved re/im)
+    juce::FloatVectorOperations::copy(refSpectrum, ref, numSamples);
+    juce::FloatVectorOperations::clear(refSpectrum + numSamples, 2 * fftSize - numSamples);
+    fft->performRealOnlyForwardTransform(refSpectrum, true);
+}
+
+void GccPhatEstimator::computeCrossSpectrum(const float* target, int numSamples)
+{
+    juce::FloatVectorOperations::copy(targetSpectrum, target, numSamples);
+    juce::FloatVectorOperations::clear(targetSpectrum + numSamples, 2 * fftSize - numSamples);
+    fft->performRealOnlyForwardTransform(targetSpectrum, true);
+
+    // Cross-power spectrum conj(Ref) * Target, written over targetSpectrum so the reference stays reusable
+    const int numBins = fftSize / 2 + 1;
+    for (int bin = 0; bin < numBins; ++bin)
+    {
+        const float refRe = refSpectrum[2 * bin];
+        const float refIm = refSpectrum[2 * bin + 1];
+        const float tgtRe = targetSpectrum[2 * bin];
+        const float tgtIm = targetSpectrum[2 * bin + 1];
+
+        targetSpectrum[2 * bin] = refRe * tgtRe + refIm * tgtIm;
+        targetSpectrum[2 * bin + 1] = refRe * tgtIm - refIm * tgtRe;
+    }
+}
+
+int GccPhatEstimator::findPeakFromCrossSpectrum(int maxLagSamples, float& confidence)
+{
+    // PHAT weighting: keep only the phase of each bin
+    const int numBins = fftSize / 2 + 1;
+    for (int bin = 0; bin < numBins; ++bin)
+    {
+        const float crossRe = targetSpectrum[2 * bin];
+        const float crossIm = targetSpectrum[2 * bin + 1];
+        const float magnitude = std::sqrt(crossRe * crossRe + crossIm * crossIm);
+        const float weight = magnitude > 1e-20f ? 1.0f / magnitude : 0.0f;
+
+        targetSpectrum[2 * bin] = crossRe * weight;
+        targetSpectrum[2 * bin + 1] = crossIm * weight;
+    }
+
+    // Back to the lag domain: index k holds sum(ref[i] * target[i + k])
+    fft->performRealOnlyInverseTransform(targetSpectrum);
+
+    int bestLag = 0;
+    float bestCorrelation = -std::numeric_limits<float>::infinity();
+
+    for (int lag = 0; lag <= maxLagSamples; ++lag)
+    {
+        if (targetSpectrum[lag] > bestCorrelation)
+        {
+            bestCorrelation = targetSpectrum[lag];
+            bestLag = lag;
+        }
+    }
+
+    confidence = CorrelationKernels::peakToSidelobeRatio(targetSpectrum, maxLagSamples + 1, bestLag);
+    return bestLag;
+}
+
+int GccPhatEstimator::estimateDelay(const float* ref, const float* target, int numSamples, int maxLagSamples)
+{
+    int lag = 0;
+    estimateDelays(ref, &target, 1, numSamples, maxLagSamples, &lag);
+    return lag;
+}
+
+void GccPhatEstimator::estimateDelays(const float* ref, const float* const* targets, int numTargets,
+                                      int numSamples, int maxLagSamples, int* lags)
+{
+    jassert(fft != nullptr); // prepare() must be called first
+    for (int t = 0; t < numTargets; ++t)
+        lags[t] = 0;
+
+    if (fft == nullptr)
+        return;
+
+    jassert(numTargets <= maxNumTargets); // one confidence slot per prepared target
+    numTargets = juce::jmin(numTargets, maxNumTargets);
+    for (int t = 0; t < numTargets; ++t)
+        confidences[t] = CorrelationKernels::minConfidenceDb;
+
+    if (numSamples <= 0)
+        return;
+
+    numSamples = juce::jmin(numSamples, maxNumSamples);
+    maxLagSamples = juce::jlimit(0, numSamples - 1, maxLagSamples);
+
+    computeReferenceSpectrum(ref, numSamples);
+    for (int t = 0; t < numTargets; ++t)
+    {
+        computeCrossSpectrum(targets[t], numSamples);
+        lags[t] = findPeakFromCrossSpectrum(maxLagSamples, confidences[t]);
+    }
+}
+
+//==============================================================================
+void GccPhatEstimator::pushSamples(const float* ref, const float* target, int numSamples)
+{
+    pushSamples(ref, &target, 1, numSamples);
+}
+
+void GccPhatEstimator::pushSamples(const float* ref, const float* const* targets, int numTargets, int numSamples)
+{
+    jassert(fft != nullptr); // prepare() must be called first
+    if (fft == nullptr)
+        return;
+
+    // A different set of targets makes the running averages meaningless
+    numTargets = juce::jlimit(1, maxNumTargets, numTargets);
+    if (numTargets != numActiveTargets)
+    {
+        resetAccumulator();
+        numActiveTargets = numTargets;
+    }
+
+    int offset = 0;
+    while (offset < numSamples)
+    {
+        const int numToCopy = juce::jmin(numSamples - offset, maxNumSamples - segmentFill);
+        juce::FloatVectorOperations::copy(segmentRef + segmentFill, ref + offset, numToCopy);
+        for (int t = 0; t < numActiveTargets; ++t)
+            juce::FloatVectorOperations::copy(segmentTargets + t * maxNumSamples + segmentFill, targets[t] + offset, numToCopy);
+        segmentFill += numToCopy;
+        offset += numToCopy;
+
+        if (segmentFill == maxNumSamples)
+        {
+            accumulateSegment();
+
+            // Keep the newest (window - hop) samples as the start of the next segment
+            const int overlap = maxNumSamples - hopSize;
+            std::memmove(segmentRef, segmentRef + hopSize, sizeof(float) * static_cast<size_t>(overlap));
+            for (int t = 0; t < numActiveTargets; ++t)
+            {
+                float* segment = segmentTargets + t * maxNumSamples;
+                std::memmove(segment, segment + hopSize, sizeof(float) * static_cast<size_t>(overlap));
+            }
+            segmentFill = overlap;
+        }
+    }
+}
+
+void GccPhatEstimator::accumulateSegment()
+{
+    computeReferenceSpectrum(segmentRef, maxNumSamples);
+
+    // Exponentially weighted average; the first segment initialises it
+    const float weight = numSegmentsAccumulated == 0 ? 1.0f : smoothing;
+    const int numFloats = fftSize + 2;
+
+    for (int t = 0; t < numActiveTargets; ++t)
+    {
+        computeCrossSpectrum(segmentTargets + t * maxNumSamples, maxNumSamples);
+
+        float* accumulated = getAccumulatedSpectrum(t);
+        for (int i = 0; i < numFloats; ++i)
+            accumulated[i] += weight * (targetSpectrum[i] - accumulated[i]);
+
+        accumulatedLagIsStale[t] = true;
+    }
+
+    ++numSegmentsAccumulated;
+    ++segmentCount;
+}
+
+void GccPhatEstimator::writeAccumulator(juce::OutputStream& output) const
+{
+    const int numBins = fftSize / 2 + 1;
+    const int numTargets = fft != nullptr && numSegmentsAccumulated > 0 ? numActiveTargets : 0;
+    output.writeInt(numBins);
+    output.writeInt(numTargets);
+
+    for (int t = 0; t < numTargets; ++t)
+    {
+        const float* accumulated = accumulatedSpectrum + t * (fftSize + 2);
+        float peak = 0.0f;
+        for (int bin = 0; bin < numBins; ++bin)
+            peak = juce::jmax(peak, std::hypot(accumulated[2 * bin], accumulated[2 * bin + 1]));
+
+        output.writeFloat(peak);
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            const float re = accumulated[2 * bin];
+            const float im = accumulated[2 * bin + 1];
+            const float levelDb = peak > 0.0f ? juce::Decibels::gainToDecibels(std::hypot(re, im) / peak, -327.0f) : -327.0f;
+            output.writeShort(static_cast<short>(juce::roundToInt(levelDb * 100.0f)));
+            output.writeShort(static_cast<short>(juce::roundToInt(std::atan2(im, re) / juce::MathConstants<float>::pi * 32767.0f)));
+        }
+    }
+}
+
+bool GccPhatEstimator::readAccumulator(juce::InputStream& input)
+{
+    resetAccumulator();
+
+    const int numBins = input.readInt();
+    const int numTargets = input.readInt();
+    if (fft == nullptr || numBins != fftSize / 2 + 1 || ! juce::isPositiveAndNotGreaterThan(numTargets, maxNumTargets)
+        || input.getNumBytesRemaining() < static_cast<juce::int64>(numTargets) * (4 + 4 * numBins))
+        return false;
+
+    for (int t = 0; t < numTargets; ++t)
+    {
+        float* accumulated = getAccumulatedSpectrum(t);
+        const float peak = input.readFloat();
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            const float magnitude = peak * juce::Decibels::decibelsToGain(static_cast<float>(input.readShort()) * 0.01f, -327.0f);
+            const float phase = static_cast<float>(input.readShort()) / 32767.0f * juce::MathConstants<float>::pi;
+            accumulated[2 * bin] = magnitude * std::cos(phase);
+            accumulated[2 * bin + 1] = magnitude * std::sin(phase);
+        }
+    }
+
+    // Counts as one segment, so new audio blends in at the usual smoothing
+    numActiveTargets = juce::jmax(1, numTargets);
+    numSegmentsAccumulated = numTargets > 0 ? 1 : 0;
+    return numTargets > 0;
+}
+
+int GccPhatEstimator::getAccumulatedDelay(int maxLagSamples, int targetIndex)
+{
+    jassert(fft != nullptr); // prepare() must be called first
+    if (fft == nullptr || numSegmentsAccumulated == 0 || ! juce::isPositiveAndBelow(targetIndex, numActiveTargets))
+        return 0;
+
+    maxLagSamples = juce::jlimit(0, maxNumSamples - 1, maxLagSamples);
+    if (maxLagSamples != accumulatedLagMax)
+    {
+        for (int t = 0; t < maxNumTargets; ++t)
+            accumulatedLagIsStale[t] = true;
+        accumulatedLagMax = maxLagSamples;
+    }
+
+    // Only pay for the inverse transform when a new segment has been folded in
+    if (accumulatedLagIsStale[targetIndex])
+    {
+        juce::FloatVectorOperations::copy(targetSpectrum, getAccumulatedSpectrum(targetIndex), fftSize + 2);
+        accumulatedLags[targetIndex] = findPeakFromCrossSpectrum(maxLagSamples, accumulatedConfidences[targetIndex]);
+        accumulatedLagIsStale[targetIndex] = false;
+    }
+
+    confidences[targetIndex] = accumulatedConfidences[targetIndex];
+    return accumulatedLags[targetIndex];
+}
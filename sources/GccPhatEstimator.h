@@ -0,0 +1,89 @@
+#pragma once
+
+//==============================================================================
+// Frequency-domain delay estimator: generalized cross-correlation with PHAT weighting.
+// The FFT plan and all spectra are allocated once in prepare(), so nothing here
+// touches the heap after that.
+//
+// Two ways to use it:
+//  - estimateDelay() correlates one window from scratch.
+//  - pushSamples() streams audio in. Every hop (half a window) the cross-power
+//    spectrum of the latest window is folded into an exponentially weighted average.
+//    getAccumulatedDelay() reads the lag from that average. The average survives
+//    discardPartialSegment(), so it carries over from one beat to the next.
+//
+// Several targets can share one reference. The reference is transformed once, and
+// each target then costs one forward FFT and its own running average.
+class GccPhatEstimator
+{
+public:
+    //==============================================================================
+    GccPhatEstimator() = default;
+
+    void prepare(int maxNumSamples, int maxNumTargets = 1);
+    void reset();
+
+    // Whole-sample lag, in the convention of CorrelationKernels.h
+    int estimateDelay(const float* ref, const float* target, int numSamples, int maxLagSamples);
+
+    // One reference transform for all targets; lags[t] receives the lag of targets[t]
+    void estimateDelays(const float* ref, const float* const* targets, int numTargets,
+                        int numSamples, int maxLagSamples, int* lags);
+
+    //==============================================================================
+    // Weight of each new segment in the running average, in (0, 1]
+    void setSmoothing(float newSmoothing) { smoothing = juce::jlimit(0.01f, 1.0f, newSmoothing); }
+    void pushSamples(const float* ref, const float* target, int numSamples);
+    void pushSamples(const float* ref, const float* const* targets, int numTargets, int numSamples);
+    void discardPartialSegment() { segmentFill = 0; }
+    void resetAccumulator();
+    bool hasAccumulatedSpectrum() const { return numSegmentsAccumulated > 0; }
+    int getAccumulatedDelay(int maxLagSamples, int targetIndex = 0);
+
+    // Segments folded into the average since prepare(). Only counts up, so the accumulated
+    // delay has seen new audio exactly when this has changed.
+    juce::int64 getSegmentCount() const { return segmentCount; }
+
+    // Compact copy of the running averages, for warm starts. Per bin it stores two 16-bit
+    // values: the level relative to the loudest bin, in 0.01 dB steps, and the phase.
+    // PHAT keeps only the phase, so a restored average gives the saved lags.
+    // readAccumulator() leaves the average empty unless the layout matches this prepare().
+    void writeAccumulator(juce::OutputStream& output) const;
+    bool readAccumulator(juce::InputStream& input);
+
+    // Peak-to-sidelobe ratio in dB behind the last lag returned for this target, by either path
+    float getConfidence(int targetIndex = 0) const { return confidences[targetIndex]; }
+
+    int getMaxNumSamples() const { return maxNumSamples; }
+    int getMaxNumTargets() const { return maxNumTargets; }
+
+private:
+    //==============================================================================
+    void computeReferenceSpectrum(const float* ref, int numSamples);
+    void computeCrossSpectrum(const float* target, int numSamples);
+    int findPeakFromCrossSpectrum(int maxLagSamples, float& confidence);
+    void accumulateSegment();
+    float* getAccumulatedSpectrum(int targetIndex) { return accumulatedSpectrum + targetIndex * (fftSize + 2); }
+
+    std::unique_ptr<juce::dsp::FFT> fft;
+    juce::HeapBlock<float> refSpectrum;         // 2 * fftSize floats, reference transform, reused for every target
+    juce::HeapBlock<float> targetSpectrum;      // 2 * fftSize floats, target transform, then the cross-spectrum
+    juce::HeapBlock<float> accumulatedSpectrum; // fftSize + 2 floats per target, bins 0 .. fftSize / 2
+    juce::HeapBlock<float> segmentRef;          // maxNumSamples, segment being assembled
+    juce::HeapBlock<float> segmentTargets;      // maxNumSamples per target
+    juce::HeapBlock<int> accumulatedLags;       // cached peak per target
+    juce::HeapBlock<float> accumulatedConfidences;  // cached with the peak
+    juce::HeapBlock<float> confidences;         // per target, of the last returned lag
+    juce::HeapBlock<bool> accumulatedLagIsStale;
+    int fftSize = 0;
+    int maxNumSamples = 0;
+    int maxNumTargets = 1;
+    int numActiveTargets = 1;
+    int hopSize = 1;
+    int segmentFill = 0;
+    int numSegmentsAccumulated = 0;
+    juce::int64 segmentCount = 0;               // Never reset by the accumulator
+    float smoothing = 0.2f;
+    int accumulatedLagMax = -1;
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GccPhatEstimator)
+};
@@ -0,0 +1,267 @@
+#include <JuceHeader.h>
+#include "CorrelationKernels.h"
+#include "LongRangeCorrelator.h"
+
+//==============================================================================
+void LongRangeCorrelator::prepare(int maxLagSamples, int newDecimationFactor, int newPartitionSize, int newMaxNumTargets)
+{
+    maxLag = juce::jmax(0, maxLagSamples);
+    decimationFactor = juce::jmax(1, newDecimationFactor);
+    partitionSize = juce::nextPowerOfTwo(juce::jmax(16, newPartitionSize));
+    maxNumTargets = juce::jmax(1, newMaxNumTargets);
+    numActiveTargets = 1;
+
+    // Enough partitions that the last one reaches the largest decimated lag
+    const int maxDecimatedLag = maxLag / decimationFactor + 1;
+    numPartitions = maxDecimatedLag / partitionSize + 1;
+
+    // Anti-aliased decimation of the reference and every target, a chunk at a time
+    decimator.prepare(decimationFactor, 1 + maxNumTargets);
+    chunkSize = 64 * decimationFactor;
+    decimatedChunk.setSize(1 + maxNumTargets, chunkSize / decimationFactor + 1);
+    chunkInputs.allocate(static_cast<size_t>(1 + maxNumTargets), true);
+    chunkOutputs.allocate(static_cast<size_t>(1 + maxNumTargets), true);
+
+    // The newest reference partition against one partition of target per FFT, zero-padded to stay linear
+    const int fftOrder = juce::findHighestSetBit(static_cast<juce::uint32>(2 * partitionSize));
+    fft = std::make_unique<juce::dsp::FFT>(fftOrder);
+    fftSize = fft->getSize();
+    passbandBins = juce::jlimit(1, fftSize / 2 + 1, static_cast<int>(0.8 * (fftSize / 2)));
+
+    // History: the search range, the refinement window either side of it and the filter
+    refineLength = partitionSize * decimationFactor;
+    decimatedSize = (numPartitions + 1) * partitionSize;
+    fullRateSize = maxLag + refineLength + 2 * decimationFactor + decimator.getNumTaps() + 2;
+
+    fullRateRings.clear();
+    decimatedRings.clear();
+    for (int channel = 0; channel < 1 + maxNumTargets; ++channel)
+    {
+        fullRateRings.push_back(std::make_unique<MirroredRingBuffer>());
+        fullRateRings.back()->allocate(fullRateSize);
+        decimatedRings.push_back(std::make_unique<MirroredRingBuffer>());
+        decimatedRings.back()->allocate(decimatedSize);
+    }
+    refSpectrum.allocate(static_cast<size_t>(2 * fftSize), true);
+    workSpectrum.allocate(static_cast<size_t>(2 * fftSize), true);
+    accumulatedSpectra.allocate(static_cast<size_t>(maxNumTargets * numPartitions * (fftSize + 2)), true);
+    coarseCorrelation.allocate(static_cast<size_t>(numPartitions * partitionSize), true);
+    delays.allocate(static_cast<size_t>(maxNumTargets), true);
+    confidences.allocate(static_cast<size_t>(maxNumTargets), true);
+    delayIsStale.allocate(static_cast<size_t>(maxNumTargets), true);
+
+    segmentCount = 0;
+    reset();
+}
+
+void LongRangeCorrelator::reset()
+{
+    if (fftSize > 0)
+    {
+        juce::FloatVectorOperations::clear(accumulatedSpectra, maxNumTargets * numPartitions * (fftSize + 2));
+        for (int t = 0; t < maxNumTargets; ++t)
+        {
+            delays[t] = 0.0f;
+            confidences[t] = CorrelationKernels::minConfidenceDb;
+            delayIsStale[t] = true;
+        }
+    }
+
+    numSegmentsAccumulated = 0;
+    discardHistory();
+}
+
+void LongRangeCorrelator::discardHistory()
+{
+    fullRateFill = 0;
+    decimatedFill = 0;
+    samplesSinceSegment = 0;
+    decimator.reset();
+}
+
+//==============================================================================
+const float* LongRangeCorrelator::getNewestFullRate(int channel, int numSamples) const
+{
+    jassert(numSamples <= fullRateSize);
+    return fullRateRings[static_cast<size_t>(channel)]->getNewest(numSamples);
+}
+
+const float* LongRangeCorrelator::getNewestDecimated(int channel, int numSamples) const
+{
+    jassert(numSamples <= decimatedSize);
+    return decimatedRings[static_cast<size_t>(channel)]->getNewest(numSamples);
+}
+
+float* LongRangeCorrelator::getAccumulatedSpectrum(int targetIndex, int partition)
+{
+    return accumulatedSpectra + (targetIndex * numPartitions + partition) * (fftSize + 2);
+}
+
+void LongRangeCorrelator::pushSamples(const float* ref, const float* const* targets, int numTargets, int numSamples)
+{
+    jassert(fft != nullptr); // prepare() must be called first
+    if (fft == nullptr)
+        return;
+
+    // A different set of targets makes the running averages meaningless
+    numTargets = juce::jlimit(1, maxNumTargets, numTargets);
+    if (numTargets != numActiveTargets)
+    {
+        reset();
+        numActiveTargets = numTargets;
+    }
+
+    const int numChannels = 1 + numActiveTargets;
+    for (int offset = 0; offset < numSamples; offset += chunkSize)
+    {
+        const int numToProcess = juce::jmin(chunkSize, numSamples - offset);
+        chunkInputs[0] = ref + offset;
+        for (int t = 0; t < numActiveTargets; ++t)
+            chunkInputs[1 + t] = targets[t] + offset;
+        for (int channel = 0; channel < numChannels; ++channel)
+            chunkOutputs[channel] = decimatedChunk.getWritePointer(channel);
+
+        writeFullRate(chunkInputs, numChannels, numToProcess);
+        appendDecimated(decimator.process(chunkInputs, chunkOutputs, numChannels, numToProcess));
+    }
+}
+
+void LongRangeCorrelator::writeFullRate(const float* const* channels, int numChannels, int numSamples)
+{
+    for (int channel = 0; channel < numChannels; ++channel)
+        fullRateRings[static_cast<size_t>(channel)]->write(channels[channel], numSamples);
+
+    fullRateFill = juce::jmin(fullRateFill + numSamples, fullRateSize);
+}
+
+void LongRangeCorrelator::appendDecimated(int numDecimated)
+{
+    // A new segment every partition, as soon as the history spans the reference partition and every lag.
+    // The chunk is written in runs that end exactly where a segment is due.
+    const int numChannels = 1 + numActiveTargets;
+    for (int index = 0; index < numDecimated;)
+    {
+        const int untilSegment = juce::jmax(1, partitionSize - samplesSinceSegment, decimatedSize - decimatedFill);
+        const int numToWrite = juce::jmin(untilSegment, numDecimated - index);
+        for (int channel = 0; channel < numChannels; ++channel)
+            decimatedRings[static_cast<size_t>(channel)]->write(decimatedChunk.getReadPointer(channel, index), numToWrite);
+
+        index += numToWrite;
+        samplesSinceSegment += numToWrite;
+        decimatedFill = juce::jmin(decimatedFill + numToWrite, decimatedSize);
+
+        if (numToWrite == untilSegment)
+        {
+            samplesSinceSegment = 0;
+            accumulateSegment();
+        }
+    }
+}
+
+void LongRangeCorrelator::accumulateSegment()
+{
+    // The oldest partition is the reference; target partitions start at the same sample, one partition apart
+    const float* ref = getNewestDecimated(0, decimatedSize);
+    juce::FloatVectorOperations::copy(refSpectrum, ref, partitionSize);
+    juce::FloatVectorOperations::clear(refSpectrum + partitionSize, 2 * fftSize - partitionSize);
+    fft->performRealOnlyForwardTransform(refSpectrum, true);
+
+    // Exponentially weighted average; the first segment initialises it
+    const float weight = numSegmentsAccumulated == 0 ? 1.0f : smoothing;
+    const int numBins = fftSize / 2 + 1;
+
+    for (int t = 0; t < numActiveTargets; ++t)
+    {
+        const float* target = getNewestDecimated(1 + t, decimatedSize);
+        for (int partition = 0; partition < numPartitions; ++partition)
+        {
+            juce::FloatVectorOperations::copy(workSpectrum, target + partition * partitionSize, fftSize);
+            juce::FloatVectorOperations::clear(workSpectrum + fftSize, fftSize);
+            fft->performRealOnlyForwardTransform(workSpectrum, true);
+
+            // conj(Ref) * Target folded straight into the average
+            float* accumulated = getAccumulatedSpectrum(t, partition);
+            for (int bin = 0; bin < numBins; ++bin)
+            {
+                const float refRe = refSpectrum[2 * bin];
+                const float refIm = refSpectrum[2 * bin + 1];
+                const float tgtRe = workSpectrum[2 * bin];
+                const float tgtIm = workSpectrum[2 * bin + 1];
+
+                accumulated[2 * bin] += weight * (refRe * tgtRe + refIm * tgtIm - accumulated[2 * bin]);
+                accumulated[2 * bin + 1] += weight * (refRe * tgtIm - refIm * tgtRe - accumulated[2 * bin + 1]);
+            }
+        }
+
+        delayIsStale[t] = true;
+    }
+
+    ++numSegmentsAccumulated;
+    ++segmentCount;
+}
+
+//==============================================================================
+float LongRangeCorrelator::getDelay(int maxLagSamples, int targetIndex)
+{
+    jassert(fft != nullptr); // prepare() must be called first
+    if (fft == nullptr || numSegmentsAccumulated == 0 || ! juce::isPositiveAndBelow(targetIndex, numActiveTargets))
+        return 0.0f;
+
+    maxLagSamples = juce::jlimit(0, maxLag, maxLagSamples);
+    if (maxLagSamples != cachedMaxLag)
+    {
+        for (int t = 0; t < maxNumTargets; ++t)
+            delayIsStale[t] = true;
+        cachedMaxLag = maxLagSamples;
+    }
+
+    // Only pay for the inverse transforms and the refinement when a new segment has been folded in
+    if (! delayIsStale[targetIndex])
+        return delays[targetIndex];
+
+    const int numBins = fftSize / 2 + 1;
+    for (int partition = 0; partition < numPartitions; ++partition)
+    {
+        // PHAT weighting inside the passband; above it the decimated signals hold only filter residue
+        const float* accumulated = getAccumulatedSpectrum(targetIndex, partition);
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            const float crossRe = accumulated[2 * bin];
+            const float crossIm = accumulated[2 * bin + 1];
+            const float magnitude = std::sqrt(crossRe * crossRe + crossIm * crossIm);
+            const float weight = bin < passbandBins && magnitude > 1e-20f ? 1.0f / magnitude : 0.0f;
+
+            workSpectrum[2 * bin] = crossRe * weight;
+            workSpectrum[2 * bin + 1] = crossIm * weight;
+        }
+
+        // Index k of this partition holds the correlation at decimated lag partition * partitionSize + k
+        fft->performRealOnlyInverseTransform(workSpectrum);
+        juce::FloatVectorOperations::copy(coarseCorrelation + partition * partitionSize, workSpectrum, partitionSize);
+    }
+
+    const int maxDecimatedLag = juce::jmin(maxLagSamples / decimationFactor, numPartitions * partitionSize - 1);
+    int coarsePeak = 0;
+    for (int lag = 1; lag <= maxDecimatedLag; ++lag)
+        if (coarseCorrelation[lag] > coarseCorrelation[coarsePeak])
+            coarsePeak = lag;
+
+    confidences[targetIndex] = CorrelationKernels::peakToSidelobeRatio(coarseCorrelation, maxDecimatedLag + 1, coarsePeak);
+    delays[targetIndex] = refine(coarsePeak * decimationFactor, maxLagSamples, targetIndex);
+    delayIsStale[targetIndex] = false;
+    return delays[targetIndex];
+}
+
+float LongRangeCorrelator::refine(int coarseLag, int maxLagSamples, int targetIndex) const
+{
+    // Full-rate correlation within one decimation step of the coarse peak, on the newest contiguous audio
+    const int fineStart = juce::jmax(0, coarseLag - decimationFactor);
+    const int fineEnd = juce::jmin(maxLagSamples, coarseLag + decimationFactor);
+    const int span = refineLength + fineEnd + 2; // The parabolic fit reads one lag past fineEnd
+    if (fullRateFill < span)
+        return static_cast<float>(coarseLag); // History cut short by a discontinuity since the last segment
+
+    const float* ref = getNewestFullRate(0, span);
+    const float* target = getNewestFullRate(1 + targetIndex, span);
+    return CorrelationKernels::refinePeak(ref, target, refineLength, fineStart, fineEnd);
+}
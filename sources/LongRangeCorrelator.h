@@ -0,0 +1,97 @@
+#pragma once
+
+#include "CorrelationKernels.h"
+#include "MirroredRingBuffer.h"
+#include "PolyphaseDecimator.h"
+
+//==============================================================================
+// Streaming lag search over hundreds of milliseconds.
+//
+// A direct search costs O(lags * window), and the window has to grow with the
+// range, so the cost grows quadratically. This estimator keeps that linear:
+//  - The reference and targets go through a PolyphaseDecimator as they stream in.
+//  - Every partitionSize decimated samples, the newest reference partition is
+//    correlated against the target history. The history is split into partitions
+//    of the same size, and each partition costs one FFT of 2 * partitionSize.
+//    The cross-spectrum of each partition is folded into an exponentially
+//    weighted average, as in GccPhatEstimator.
+//  - getDelay() applies PHAT weighting within the passband, picks the coarse peak
+//    across all partitions, and refines it at full rate over one decimation step
+//    either side of the peak, with a parabolic sub-sample fit.
+// Work and memory both grow with maxLagSamples / partitionSize.
+//
+// Histories are MirroredRingBuffers, so the newest samples are always contiguous. An estimate needs getSamplesForFirstEstimate() contiguous
+// samples. discardHistory() starts the history over after a discontinuity and
+// keeps the averaged spectra.
+class LongRangeCorrelator
+{
+public:
+    //==============================================================================
+    LongRangeCorrelator() = default;
+
+    void prepare(int maxLagSamples, int decimationFactor, int partitionSize, int maxNumTargets);
+    void reset();
+    void discardHistory();
+
+    // Weight of each new segment in the running average, in (0, 1]
+    void setSmoothing(float newSmoothing) { smoothing = juce::jlimit(0.01f, 1.0f, newSmoothing); }
+    void pushSamples(const float* ref, const float* const* targets, int numTargets, int numSamples);
+
+    bool hasEstimate() const { return numSegmentsAccumulated > 0; }
+
+    // Segments folded into the averages since prepare(). Only counts up, so the delay has
+    // seen new audio exactly when this has changed.
+    juce::int64 getSegmentCount() const { return segmentCount; }
+
+    // Lag convention of CorrelationKernels.h
+    float getDelay(int maxLagSamples, int targetIndex = 0);
+    float getConfidence(int targetIndex = 0) const { return confidences[targetIndex]; }
+
+    int getMaxLagSamples() const { return maxLag; }
+    int getSamplesForFirstEstimate() const { return (numPartitions + 1) * partitionSize * decimationFactor + decimator.getNumTaps(); }
+
+private:
+    //==============================================================================
+    void writeFullRate(const float* const* channels, int numChannels, int numSamples);
+    void appendDecimated(int numDecimated);
+    void accumulateSegment();
+    float refine(int coarseLag, int maxLagSamples, int targetIndex) const;
+    const float* getNewestFullRate(int channel, int numSamples) const;
+    const float* getNewestDecimated(int channel, int numSamples) const;
+    float* getAccumulatedSpectrum(int targetIndex, int partition);
+
+    std::unique_ptr<juce::dsp::FFT> fft;
+    PolyphaseDecimator decimator;
+    std::vector<std::unique_ptr<MirroredRingBuffer>> fullRateRings;    // Reference, then one per target; fullRateSize or more each
+    std::vector<std::unique_ptr<MirroredRingBuffer>> decimatedRings;   // Same layout, decimatedSize or more each
+    juce::AudioBuffer<float> decimatedChunk;    // decimator output for one chunk of input
+    juce::HeapBlock<const float*> chunkInputs;  // per-channel pointers into the chunk being decimated
+    juce::HeapBlock<float*> chunkOutputs;
+    juce::HeapBlock<float> refSpectrum;         // 2 * fftSize floats
+    juce::HeapBlock<float> workSpectrum;        // 2 * fftSize floats
+    juce::HeapBlock<float> accumulatedSpectra;  // fftSize + 2 floats per partition and target
+    juce::HeapBlock<float> coarseCorrelation;   // one value per decimated lag
+    juce::HeapBlock<float> delays;              // cached per target
+    juce::HeapBlock<float> confidences;         // per target, of the last returned delay
+    juce::HeapBlock<bool> delayIsStale;
+    int maxLag = 0;
+    int decimationFactor = 1;
+    int partitionSize = 1;
+    int numPartitions = 1;                      // Covering lags 0 .. maxLag / decimationFactor
+    int chunkSize = 1;                          // Full-rate samples decimated per pass
+    int passbandBins = 1;                       // Bins below the anti-alias cutoff, used by PHAT
+    int refineLength = 1;                       // Full-rate samples correlated by the refinement
+    int fftSize = 0;
+    int fullRateSize = 0;
+    int decimatedSize = 0;
+    int fullRateFill = 0;                       // Contiguous samples since the last discontinuity
+    int decimatedFill = 0;
+    int samplesSinceSegment = 0;                // Decimated
+    int maxNumTargets = 1;
+    int numActiveTargets = 1;
+    int numSegmentsAccumulated = 0;
+    juce::int64 segmentCount = 0;               // Never reset by reset()
+    int cachedMaxLag = -1;
+    float smoothing = 0.2f;
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LongRangeCorrelator)
+};
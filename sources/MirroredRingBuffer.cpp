@@ -0,0 +1,138 @@
+#include <JuceHeader.h>
+#include "MirroredRingBuffer.h"
+
+#if JUCE_LINUX
+ #include <sys/mman.h>
+ #include <unistd.h>
+#endif
+
+//==============================================================================
+MirroredRingBuffer::~MirroredRingBuffer()
+{
+    release();
+}
+
+void MirroredRingBuffer::allocate(int minCapacity)
+{
+    release();
+    minCapacity = juce::jmax(1, minCapacity);
+
+   #if JUCE_LINUX
+    // Both mappings must start on a page boundary, so the capacity is a whole number of pages
+    const auto pageBytes = static_cast<size_t>(juce::jmax(1L, sysconf(_SC_PAGESIZE)));
+    const auto numBytes = (static_cast<size_t>(minCapacity) * sizeof(float) + pageBytes - 1) / pageBytes * pageBytes;
+    if (mapMirrored(numBytes))
+    {
+        capacity = static_cast<int>(numBytes / sizeof(float));
+        data = static_cast<float*>(mapping);
+        clear();
+        return;
+    }
+   #endif
+
+    capacity = minCapacity;
+    fallback.allocate(static_cast<size_t>(2 * capacity), true);
+    data = fallback;
+    clear();
+}
+
+bool MirroredRingBuffer::mapMirrored(size_t numBytes)
+{
+   #if JUCE_LINUX
+    const int fd = memfd_create("inPhase analysis ring", MFD_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    if (ftruncate(fd, static_cast<off_t>(numBytes)) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    // Reserve the address range once, then map the same pages over both halves of it
+    auto* base = static_cast<char*>(mmap(nullptr, 2 * numBytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (base == MAP_FAILED)
+    {
+        close(fd);
+        return false;
+    }
+
+    void* first = mmap(base, numBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    void* second = mmap(base + numBytes, numBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    close(fd); // The mappings keep the memory alive
+
+    if (first != base || second != base + numBytes)
+    {
+        munmap(base, 2 * numBytes);
+        return false;
+    }
+
+    mapping = base;
+    mappingBytes = numBytes;
+    return true;
+   #else
+    juce::ignoreUnused(numBytes);
+    return false;
+   #endif
+}
+
+void MirroredRingBuffer::release()
+{
+   #if JUCE_LINUX
+    if (mapping != nullptr)
+        munmap(mapping, 2 * mappingBytes);
+   #endif
+
+    mapping = nullptr;
+    mappingBytes = 0;
+    fallback.free();
+    data = nullptr;
+    capacity = 0;
+    writePosition = 0;
+}
+
+void MirroredRingBuffer::clear()
+{
+    // Through the mapping the second half is the first; the fallback has to clear both
+    if (data != nullptr)
+        juce::FloatVectorOperations::clear(data, isVirtualMemoryMirrored() ? capacity : 2 * capacity);
+
+    writePosition = 0;
+}
+
+//==============================================================================
+void MirroredRingBuffer::write(const float* samples, int numSamples)
+{
+    jassert(data != nullptr); // allocate() must be called first
+    if (data == nullptr || numSamples <= 0)
+        return;
+
+    // Older samples of a long run would be overwritten straight away
+    if (numSamples > capacity)
+    {
+        samples += numSamples - capacity;
+        numSamples = capacity;
+    }
+
+    // Through the mapping, a write that runs past the end wraps by itself
+    const int firstChunk = juce::jmin(numSamples, capacity - writePosition);
+    if (isVirtualMemoryMirrored())
+    {
+        juce::FloatVectorOperations::copy(data + writePosition, samples, numSamples);
+    }
+    else
+    {
+        juce::FloatVectorOperations::copy(data + writePosition, samples, firstChunk);
+        juce::FloatVectorOperations::copy(data + writePosition + capacity, samples, firstChunk);
+        juce::FloatVectorOperations::copy(data, samples + firstChunk, numSamples - firstChunk);
+        juce::FloatVectorOperations::copy(data + capacity, samples + firstChunk, numSamples - firstChunk);
+    }
+
+    writePosition = (writePosition + numSamples) % capacity;
+}
+
+const float* MirroredRingBuffer::getNewest(int numSamples) const
+{
+    jassert(juce::isPositiveAndNotGreaterThan(numSamples, capacity));
+    return data + writePosition + capacity - numSamples;
+}
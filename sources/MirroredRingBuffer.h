@@ -0,0 +1,46 @@
+#pragma once
+
+//==============================================================================
+// Single-channel ring buffer whose newest samples can always be read as one
+// contiguous span, oldest first, with no copy.
+//
+// On Linux the storage is a memfd mapped twice, back to back, into one
+// reservation, so reading past the end of the ring lands at its start in hardware.
+// The capacity is then rounded up to a whole number of pages. Where that is not
+// available, or the mapping fails, a buffer of twice the capacity is used instead,
+// and every sample is written into both halves.
+//
+// allocate() maps or allocates and belongs on the message thread. write(), clear()
+// and getNewest() do neither and are fine on the audio and analysis threads.
+class MirroredRingBuffer
+{
+public:
+    //==============================================================================
+    MirroredRingBuffer() = default;
+    ~MirroredRingBuffer();
+
+    void allocate(int minCapacity);
+    void clear();
+
+    // Only the newest getCapacity() samples of a longer run are kept
+    void write(const float* samples, int numSamples);
+
+    // The newest numSamples samples (at most getCapacity()), contiguous, oldest first
+    const float* getNewest(int numSamples) const;
+
+    int getCapacity() const { return capacity; }
+    bool isVirtualMemoryMirrored() const { return mapping != nullptr; }
+
+private:
+    //==============================================================================
+    bool mapMirrored(size_t numBytes);
+    void release();
+
+    float* data = nullptr;              // 2 * capacity readable floats
+    void* mapping = nullptr;            // Base of the double mapping, if in use
+    size_t mappingBytes = 0;            // Bytes per half of the mapping
+    juce::HeapBlock<float> fallback;    // Copy-based mirror
+    int capacity = 0;
+    int writePosition = 0;
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MirroredRingBuffer)
+};
@@ -0,0 +1,54 @@
+#include <JuceHeader.h>
+#include "OnsetDetector.h"
+
+//==============================================================================
+void OnsetDetector::prepare(double sampleRate)
+{
+    // Time constant to one-pole coefficient: the envelope covers 1 - 1/e of a step in timeMs
+    const auto coefficient = [sampleRate](float timeMs)
+    {
+        return static_cast<float>(1.0 - std::exp(-1000.0 / (timeMs * sampleRate)));
+    };
+
+    fastAttack = coefficient(fastAttackMs);
+    fastRelease = coefficient(fastReleaseMs);
+    slowCoefficient = coefficient(slowMs);
+    holdOffSamples = static_cast<int>(holdOffMs * sampleRate / 1000.0);
+    onsetRatio = juce::Decibels::decibelsToGain(onsetRatioDb);
+    floorLevel = juce::Decibels::decibelsToGain(floorDb);
+
+    reset();
+}
+
+void OnsetDetector::reset()
+{
+    fastEnvelope = 0.0f;
+    slowEnvelope = 0.0f;
+    samplesSinceOnset = holdOffSamples; // Ready to trigger straight away
+}
+
+int OnsetDetector::process(const float* samples, int numSamples)
+{
+    int onsetIndex = -1;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const float level = std::abs(samples[i]);
+        fastEnvelope += (level > fastEnvelope ? fastAttack : fastRelease) * (level - fastEnvelope);
+        slowEnvelope += slowCoefficient * (level - slowEnvelope);
+
+        if (samplesSinceOnset < holdOffSamples)
+        {
+            ++samplesSinceOnset;
+            continue;
+        }
+
+        if (onsetIndex < 0 && fastEnvelope > floorLevel && fastEnvelope > onsetRatio * slowEnvelope)
+        {
+            onsetIndex = i;
+            samplesSinceOnset = 0;
+        }
+    }
+
+    return onsetIndex;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+//==============================================================================
+// Transient detector for the sidechain, cheap enough for the audio thread.
+// Two one-pole envelope followers run on the rectified signal: a fast one that
+// tracks attacks and a slow one that tracks the background level. An onset is a
+// sample where the fast envelope rises above the slow one by onsetRatioDb, above
+// an absolute floor. A hold-off period after each onset stops one transient from
+// triggering several times.
+class OnsetDetector
+{
+public:
+    //==============================================================================
+    OnsetDetector() = default;
+
+    void prepare(double sampleRate);
+    void reset();
+
+    // Index of the first onset in the block, or -1. The envelopes run over the whole block either way.
+    int process(const float* samples, int numSamples);
+
+private:
+    //==============================================================================
+    float fastAttack = 0.0f;        // One-pole coefficients
+    float fastRelease = 0.0f;
+    float slowCoefficient = 0.0f;
+    float fastEnvelope = 0.0f;
+    float slowEnvelope = 0.0f;
+    int holdOffSamples = 0;
+    int samplesSinceOnset = 0;
+    float onsetRatio = 1.0f;        // Linear, from onsetRatioDb
+    float floorLevel = 0.0f;        // Linear, from floorDb
+    static constexpr float fastAttackMs = 0.5f;
+    static constexpr float fastReleaseMs = 20.0f;
+    static constexpr float slowMs = 200.0f;
+    static constexpr float holdOffMs = 100.0f;
+    static constexpr float onsetRatioDb = 9.0f;
+    static constexpr float floorDb = -50.0f;
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OnsetDetector)
+};
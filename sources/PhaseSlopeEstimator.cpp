@@ -0,0 +1,134 @@
+#include <JuceHeader.h>
+#include "CorrelationKernels.h"
+#include "PhaseSlopeEstimator.h"
+
+namespace
+{
+    // Weighted least-squares slope of the phase of spectrum (interleaved re/im) after derotating it by delay samples.
+    // A delay of d samples gives a phase of -k d / binsPerRadian at bin k.
+    // With small residual angles, Im ~ |X| phase and Re ~ |X|. Weighting each bin by Re turns the fit into
+    // sum(k Im) / sum(k^2 Re), so neither an angle nor a magnitude is needed per bin.
+    // The derotating phasor is advanced by complex multiplication, so there is no trig per bin either.
+    double fitResidualSlope(const float* spectrum, int numBins, double delay, double binsPerRadian)
+    {
+        const double rotationAngle = delay / binsPerRadian;
+        const double rotationRe = std::cos(rotationAngle), rotationIm = std::sin(rotationAngle);
+        double phasorRe = rotationRe, phasorIm = rotationIm;
+        double weightedProduct = 0.0, weightedBinSquare = 0.0;
+
+        for (int bin = 1; bin < numBins - 1; ++bin) // skip DC and Nyquist
+        {
+            const double crossRe = spectrum[2 * bin];
+            const double crossIm = spectrum[2 * bin + 1];
+            const double residualRe = crossRe * phasorRe - crossIm * phasorIm;
+            const double residualIm = crossRe * phasorIm + crossIm * phasorRe;
+
+            // Bins that are still more than pi/2 off are noise or wrapped; leave them out of the fit
+            if (residualRe > 0.0)
+            {
+                weightedProduct += bin * residualIm;
+                weightedBinSquare += bin * bin * residualRe;
+            }
+
+            const double nextRe = phasorRe * rotationRe - phasorIm * rotationIm;
+            phasorIm = phasorRe * rotationIm + phasorIm * rotationRe;
+            phasorRe = nextRe;
+        }
+
+        return weightedBinSquare > 0.0 ? weightedProduct / weightedBinSquare : 0.0;
+    }
+}
+
+//==============================================================================
+void PhaseSlopeEstimator::prepare(int newMaxNumSamples)
+{
+    maxNumSamples = juce::jmax(1, newMaxNumSamples);
+
+    // Zero-pad to twice the window: keeps adjacent-bin phase increments below pi for any in-range lag
+    const int fftOrder = juce::findHighestSetBit(static_cast<juce::uint32>(juce::nextPowerOfTwo(2 * maxNumSamples)));
+    fft = std::make_unique<juce::dsp::FFT>(fftOrder);
+    fftSize = fft->getSize();
+
+    refSpectrum.allocate(static_cast<size_t>(2 * fftSize), true);
+    targetSpectrum.allocate(static_cast<size_t>(2 * fftSize), true);
+}
+
+void PhaseSlopeEstimator::reset()
+{
+    if (fftSize > 0)
+    {
+        juce::FloatVectorOperations::clear(refSpectrum, 2 * fftSize);
+        juce::FloatVectorOperations::clear(targetSpectrum, 2 * fftSize);
+    }
+
+    confidence = CorrelationKernels::minConfidenceDb;
+}
+
+float PhaseSlopeEstimator::estimateDelay(const float* ref, const float* target, int numSamples, int maxLagSamples)
+{
+    jassert(fft != nullptr); // prepare() must be called first
+    confidence = CorrelationKernels::minConfidenceDb;
+    if (fft == nullptr || numSamples <= 0)
+        return 0.0f;
+
+    numSamples = juce::jmin(numSamples, maxNumSamples);
+
+    // Load zero-padded inputs and transform (bins 0 .. fftSize / 2, interleaved re/im)
+    juce::FloatVectorOperations::copy(refSpectrum, ref, numSamples);
+    juce::FloatVectorOperations::clear(refSpectrum + numSamples, 2 * fftSize - numSamples);
+    juce::FloatVectorOperations::copy(targetSpectrum, target, numSamples);
+    juce::FloatVectorOperations::clear(targetSpectrum + numSamples, 2 * fftSize - numSamples);
+
+    fft->performRealOnlyForwardTransform(refSpectrum, true);
+    fft->performRealOnlyForwardTransform(targetSpectrum, true);
+
+    // Cross-spectrum conj(Ref) * Target, kept in targetSpectrum and copied to refSpectrum for the lag search
+    const int numBins = fftSize / 2 + 1;
+    for (int bin = 0; bin < numBins; ++bin)
+    {
+        const float refRe = refSpectrum[2 * bin];
+        const float refIm = refSpectrum[2 * bin + 1];
+        const float tgtRe = targetSpectrum[2 * bin];
+        const float tgtIm = targetSpectrum[2 * bin + 1];
+
+        targetSpectrum[2 * bin] = refRe * tgtRe + refIm * tgtIm;
+        targetSpectrum[2 * bin + 1] = refRe * tgtIm - refIm * tgtRe;
+    }
+
+    juce::FloatVectorOperations::copy(refSpectrum, targetSpectrum, 2 * numBins);
+
+    // Coarse integer delay: the cross-correlation peak, so the phase fit below starts unwrapped
+    fft->performRealOnlyInverseTransform(refSpectrum);
+    maxLagSamples = juce::jlimit(0, numSamples - 1, maxLagSamples);
+
+    int coarseLag = 0;
+    for (int lag = 1; lag <= maxLagSamples; ++lag)
+        if (refSpectrum[lag] > refSpectrum[coarseLag])
+            coarseLag = lag;
+
+    if (refSpectrum[coarseLag] <= 0.0f)
+        return 0.0f; // silence or no positive correlation
+
+    confidence = CorrelationKernels::peakToSidelobeRatio(refSpectrum, maxLagSamples + 1, coarseLag);
+
+    // A delay of d samples gives a phase of -2 pi k d / fftSize at bin k
+    const double binsPerRadian = fftSize / juce::MathConstants<double>::twoPi;
+    // Start from a parabolic fit through the peak, so the residual phase is already small
+    double coarseDelay = static_cast<double>(coarseLag);
+    if (coarseLag > 0)
+    {
+        const float left = refSpectrum[coarseLag - 1];
+        const float right = refSpectrum[coarseLag + 1];
+        const float curvature = left - 2.0f * refSpectrum[coarseLag] + right;
+        if (curvature < 0.0f)
+            coarseDelay += juce::jlimit(-0.5f, 0.5f, 0.5f * (left - right) / curvature);
+    }
+
+    // Refine: derotate by the coarse delay and fit the residual phase slope. The small-angle fit is
+    // biased where the residual is large, so a second pass from the first estimate fits what is left.
+    double delay = coarseDelay;
+    for (int pass = 0; pass < 2; ++pass)
+        delay -= fitResidualSlope(targetSpectrum, numBins, delay, binsPerRadian) * binsPerRadian;
+
+    return juce::jlimit(0.0f, static_cast<float>(maxLagSamples), static_cast<float>(delay));
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "CorrelationKernels.h"
+
+//==============================================================================
+// Delay estimator that fits the slope of the cross-spectrum phase.
+// The FFT plan and spectra are allocated once in prepare(), so estimateDelay() does
+// no heap work. The coarse delay comes from the cross-correlation peak (one inverse
+// real-only FFT) and a parabolic fit through it. The rest comes from a least-squares
+// fit of the residual cross-spectrum phase. After derotation that phase is small, so
+// the fit reads it straight off the derotated products and no bin needs an atan2.
+class PhaseSlopeEstimator
+{
+public:
+    //==============================================================================
+    PhaseSlopeEstimator() = default;
+
+    void prepare(int maxNumSamples);
+    void reset();
+
+    // Fractional lag, in the convention of CorrelationKernels.h, clamped to [0, maxLagSamples]
+    float estimateDelay(const float* ref, const float* target, int numSamples, int maxLagSamples);
+
+    int getMaxNumSamples() const { return maxNumSamples; }
+
+    // Peak-to-sidelobe ratio of the coarse correlation behind the last estimate, in dB
+    float getConfidence() const { return confidence; }
+
+private:
+    //==============================================================================
+    std::unique_ptr<juce::dsp::FFT> fft;
+    juce::HeapBlock<float> refSpectrum;     // 2 * fftSize floats, real-only FFT layout
+    juce::HeapBlock<float> targetSpectrum;  // 2 * fftSize floats, real-only FFT layout
+    int fftSize = 0;
+    int maxNumSamples = 0;
+    float confidence = CorrelationKernels::minConfidenceDb;
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PhaseSlopeEstimator)
+};
@@ -23,8 +23,17 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor (AudioPluginAud
     learningRateSlider.addListener(this);
     addAndMakeVisible(learningRateSlider);
 
+    // Hot-path timings: the overlay and the dump button only show while Stats is on
+    statsButton.setClickingTogglesState(true);
+    statsButton.onClick = [this] { dumpButton.setVisible(statsButton.getToggleState()); repaint(); };
+    addAndMakeVisible(statsButton);
+    dumpButton.onClick = [this] { dumpProfile(); };
+    addChildComponent(dumpButton);
+
+    // Every pixel is covered by the static layer, so nothing behind the editor needs repainting
+    setOpaque(true);
     setSize (600, 300);
-    startTimerHz (30);
+    vBlankAttachment = juce::VBlankAttachment(this, [this] { onVBlank(); });
 }
 
 AudioPluginAudioProcessorEditor::~AudioPluginAudioProcessorEditor()
@@ -33,6 +42,28 @@ AudioPluginAudioProcessorEditor::~AudioPluginAudioProcessorEditor()
 
 //==============================================================================
 void AudioPluginAudioProcessorEditor::paint(juce::Graphics& g)
+{
+    // Redrawn when the layout, slider value, PPQ window or display scale changed
+    const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    if (! juce::approximatelyEqual(scale, staticLayerScale))
+    {
+        staticLayer = juce::Image(juce::Image::RGB,
+                                  juce::jmax(1, juce::roundToInt(getWidth() * scale)),
+                                  juce::jmax(1, juce::roundToInt(getHeight() * scale)), false);
+        juce::Graphics layer(staticLayer);
+        layer.addTransform(juce::AffineTransform::scale(scale));
+        drawStaticLayer(layer);
+        staticLayerScale = scale;
+    }
+    g.drawImage(staticLayer, getLocalBounds().toFloat());
+
+    drawWaveform(g, g.getClipBounds().getIntersection(waveformAreaRect));
+
+    if (statsButton.getToggleState())
+        drawProfilerOverlay(g);
+}
+
+void AudioPluginAudioProcessorEditor::drawStaticLayer(juce::Graphics& g)
 {
     // Fill background
     g.fillAll(juce::Colours::black);
@@ -62,54 +93,128 @@ void AudioPluginAudioProcessorEditor::paint(juce::Graphics& g)
         juce::Justification::centred,
         1);
 
-    // Draw waveform and overlays in waveformAreaRect
-    const auto& buffer = processorRef.getDisplayBuffer();
-    const int numChannels = buffer.getNumChannels();
-    const int numSamples = buffer.getNumSamples();
-    const int width  = waveformAreaRect.getWidth();
-    const int height = waveformAreaRect.getHeight();
-    const float midY = waveformAreaRect.getY() + height / 2.0f;
+    // Draw computation area, behind the waveform
+    if (drawnPpqWindow)
+    {
+        const int width = waveformAreaRect.getWidth();
+        const int height = waveformAreaRect.getHeight();
+        float leftX = waveformAreaRect.getX() + drawnLeftPPQ * width;
+        float rightX = waveformAreaRect.getX() + drawnRightPPQ * width;
+
+        g.setColour(juce::Colours::white.withAlpha(0.7f));
+        g.drawLine(leftX, (float)waveformAreaRect.getY(), leftX, (float)waveformAreaRect.getBottom(), 2.0f);
+        g.drawLine(rightX, (float)waveformAreaRect.getY(), rightX, (float)waveformAreaRect.getBottom(), 2.0f);
+
+        g.setColour(juce::Colours::white.withAlpha(0.2f));
+        g.fillRect(leftX, (float)waveformAreaRect.getY(), rightX - leftX, (float)height);
+    }
+}
+
+void AudioPluginAudioProcessorEditor::drawWaveform(juce::Graphics& g, juce::Rectangle<int> clip)
+{
+    if (clip.isEmpty())
+        return;
+
+    // Only the columns under the clip region; a partial repaint covers a few of them
+    const int numChannels = waveformColumns.getNumChannels();
+    const int numColumns = juce::jmin(waveformColumns.getNumColumns(), waveformAreaRect.getWidth());
+    const int firstColumn = juce::jmax(0, clip.getX() - waveformAreaRect.getX());
+    const int endColumn = juce::jmin(numColumns, clip.getRight() - waveformAreaRect.getX());
+    const float top = (float)waveformAreaRect.getY();
+    const float bottom = (float)waveformAreaRect.getBottom();
 
     for (int ch = 0; ch < numChannels; ++ch)
     {
-        const float* samples = buffer.getReadPointer(ch);
-        juce::Path waveform;
-        waveform.startNewSubPath(waveformAreaRect.getX(), midY);
+        const float* mins = waveformColumns.getMins(ch);
+        const float* maxs = waveformColumns.getMaxs(ch);
+        g.setColour(getChannelColour(ch));
 
-        for (int x = 0; x < width; ++x)
+        // One vertical span per column: the min/max envelope of the samples under that pixel
+        for (int x = firstColumn; x < endColumn; ++x)
         {
-            int bufferIndex = juce::jmap(x, 0, width, 0, numSamples - 1);
-            float sample = samples[bufferIndex];
-            float y = juce::jmap(sample, -1.0f, 1.0f, (float)waveformAreaRect.getBottom(), (float)waveformAreaRect.getY());
-            waveform.lineTo(waveformAreaRect.getX() + x, y);
+            float yTop = juce::jlimit(top, bottom, juce::jmap(maxs[x], -1.0f, 1.0f, bottom, top));
+            float yBottom = juce::jlimit(top, bottom, juce::jmap(mins[x], -1.0f, 1.0f, bottom, top));
+            g.drawVerticalLine(waveformAreaRect.getX() + x, yTop, juce::jmax(yBottom, yTop + 1.0f));
         }
-
-        g.setColour(getChannelColour(ch));
-        g.strokePath(waveform, juce::PathStrokeType(1.5f));
     }
 
     // Draw playhead
-    int index = processorRef.getPlayheadIndex();
-    int bufferSize = buffer.getNumSamples();
-    int cursorX = waveformAreaRect.getX() + static_cast<int>(static_cast<float>(index) / bufferSize * width);
-    g.setColour(juce::Colours::greenyellow);
-    g.drawLine((float)cursorX, (float)waveformAreaRect.getY(), (float)cursorX, (float)waveformAreaRect.getBottom(), 1.5f);
-
-    // Draw computation area
-    auto* leftPPQ = processorRef.getValueTreeState().getRawParameterValue("leftPPQ");
-    auto* rightPPQ = processorRef.getValueTreeState().getRawParameterValue("rightPPQ");
-    if (leftPPQ && rightPPQ)
+    const int cursorX = getPlayheadX();
+    if (cursorX >= 0 && cursorX >= clip.getX() - 1 && cursorX <= clip.getRight())
     {
-        float leftX = waveformAreaRect.getX() + *leftPPQ * width;
-        float rightX = waveformAreaRect.getX() + *rightPPQ * width;
+        g.setColour(juce::Colours::greenyellow);
+        g.drawLine((float)cursorX, top, (float)cursorX, bottom, 1.5f);
+    }
+}
 
-        g.setColour(juce::Colours::white.withAlpha(0.7f));
-        g.drawLine(leftX, (float)waveformAreaRect.getY(), leftX, (float)waveformAreaRect.getBottom(), 2.0f);
-        g.drawLine(rightX, (float)waveformAreaRect.getY(), rightX, (float)waveformAreaRect.getBottom(), 2.0f);
+int AudioPluginAudioProcessorEditor::getPlayheadX() const
+{
+    const int bufferSize = waveformColumns.getLength();
+    if (bufferSize <= 0)
+        return -1;
 
-        g.setColour(juce::Colours::white.withAlpha(0.2f));
-        g.fillRect(leftX, (float)waveformAreaRect.getY(), rightX - leftX, (float)height);
+    const int index = waveformColumns.getPlayheadIndex();
+    return waveformAreaRect.getX() + static_cast<int>(static_cast<float>(index) / bufferSize * waveformAreaRect.getWidth());
+}
+
+juce::Rectangle<int> AudioPluginAudioProcessorEditor::getProfilerOverlayArea() const
+{
+    const int lineHeight = 14;
+    const int numLines = StageProfiler::numStages + 2;
+    return waveformAreaRect.reduced(8).removeFromTop(lineHeight * numLines + 8).removeFromLeft(400);
+}
+
+void AudioPluginAudioProcessorEditor::drawProfilerOverlay(juce::Graphics& g)
+{
+    const auto& profiler = processorRef.getProfiler();
+
+    juce::StringArray lines;
+    lines.add("stage            p50     p90     p99     max  overruns   (us)");
+    for (int s = 0; s < StageProfiler::numStages; ++s)
+    {
+        const auto stage = static_cast<StageProfiler::Stage>(s);
+        const auto stats = profiler.getStats(stage);
+        lines.add(StageProfiler::getStageName(stage).paddedRight(' ', 13)
+                  + juce::String(stats.p50Microseconds, 1).paddedLeft(' ', 8)
+                  + juce::String(stats.p90Microseconds, 1).paddedLeft(' ', 8)
+                  + juce::String(stats.p99Microseconds, 1).paddedLeft(' ', 8)
+                  + juce::String(stats.maxMicroseconds, 1).paddedLeft(' ', 8)
+                  + juce::String(static_cast<juce::int64>(stats.overruns)).paddedLeft(' ', 10));
     }
+    lines.add("dropped analysis blocks: " + juce::String(processorRef.getNumDroppedAnalysisBlocks()));
+
+    const int lineHeight = 14;
+    auto area = getProfilerOverlayArea();
+    g.setColour(juce::Colours::black.withAlpha(0.7f));
+    g.fillRect(area);
+
+    g.setFont(juce::Font(juce::FontOptions(juce::Font::getDefaultMonospacedFontName(), 12.0f, juce::Font::plain)));
+    g.setColour(juce::Colours::white.withAlpha(0.8f));
+    auto textArea = area.reduced(4);
+    for (auto& line : lines)
+        g.drawText(line, textArea.removeFromTop(lineHeight), juce::Justification::centredLeft, false);
+}
+
+void AudioPluginAudioProcessorEditor::dumpProfile()
+{
+    // Format follows the extension: .json gets the full histograms, anything else the CSV summary
+    dumpChooser = std::make_unique<juce::FileChooser>("Save hot-path timings",
+        juce::File::getSpecialLocation(juce::File::userDocumentsDirectory).getChildFile("inPhase-profile.csv"),
+        "*.csv;*.json");
+
+    const auto flags = juce::FileBrowserComponent::saveMode
+                     | juce::FileBrowserComponent::canSelectFiles
+                     | juce::FileBrowserComponent::warnAboutOverwriting;
+
+    dumpChooser->launchAsync(flags, [this](const juce::FileChooser& chooser)
+    {
+        const auto file = chooser.getResult();
+        if (file == juce::File())
+            return;
+
+        const auto& profiler = processorRef.getProfiler();
+        file.replaceWithText(file.hasFileExtension("json") ? profiler.toJson() : profiler.toCsv());
+    });
 }
 
 void AudioPluginAudioProcessorEditor::resized()
@@ -127,21 +232,115 @@ void AudioPluginAudioProcessorEditor::resized()
 
     // Store waveform area for paint()
     waveformAreaRect = total;
+    staticLayerScale = 0.0f;
+    waveformColumns.invalidate();
 
     // Place delayLabel in the bottom-right corner of waveformAreaRect
-    int labelWidth = 180;
+    int labelWidth = 320;
     int labelHeight = 24;
     int labelX = waveformAreaRect.getRight() - labelWidth - 8;
     int labelY = waveformAreaRect.getBottom() - labelHeight - 8;
     delayLabel.setBounds(labelX, labelY, labelWidth, labelHeight);
+
+    // Profiler toggles in the top-right corner of waveformAreaRect
+    auto buttonRow = waveformAreaRect.reduced(8).removeFromTop(22).removeFromRight(130);
+    statsButton.setBounds(buttonRow.removeFromRight(60));
+    dumpButton.setBounds(buttonRow.removeFromRight(64));
 }
 
-void AudioPluginAudioProcessorEditor::timerCallback()
+void AudioPluginAudioProcessorEditor::onVBlank()
 {
-    int delay = processorRef.getDelaySamples();
-    double ms = 1000.0 * delay / processorRef.getSampleRate();
-    delayLabel.setText(juce::String(ms, 2) + " ms", juce::dontSendNotification);
-    repaint();
+    updateDelayLabel();
+
+    if (updatePpqWindow())
+    {
+        staticLayerScale = 0.0f;
+        repaint();
+        return;
+    }
+
+    // Refresh the columns the processor wrote since the last frame; a torn read is retried in full next time
+    const int previousPlayheadX = lastPlayheadX;
+    if (waveformColumns.update(processorRef.getDisplayBuffer(), waveformAreaRect.getWidth()))
+    {
+        for (int i = 0; i < 2; ++i)
+        {
+            const auto dirty = waveformColumns.getDirtyRange(i);
+            if (! dirty.isEmpty())
+                repaint(waveformAreaRect.getX() + dirty.getStart(), waveformAreaRect.getY(), dirty.getLength(), waveformAreaRect.getHeight());
+        }
+    }
+
+    // The playhead line is 1.5 px wide, centred on its column
+    lastPlayheadX = getPlayheadX();
+    if (lastPlayheadX != previousPlayheadX)
+    {
+        for (int x : { previousPlayheadX, lastPlayheadX })
+            if (x >= 0)
+                repaint(x - 1, waveformAreaRect.getY(), 3, waveformAreaRect.getHeight());
+    }
+
+    const double now = juce::Time::getMillisecondCounterHiRes();
+    if (statsButton.getToggleState() && now - lastOverlayMs >= overlayIntervalMs)
+    {
+        lastOverlayMs = now;
+        repaint(getProfilerOverlayArea());
+    }
+}
+
+void AudioPluginAudioProcessorEditor::updateDelayLabel()
+{
+    // One delay and one peak-to-sidelobe confidence per aligned channel in per-channel mode.
+    // The text is only rebuilt when a value changes at the resolution it is shown with.
+    const int numTargets = juce::jmin(processorRef.getNumActiveTargets(), Params::maxTargetChannels);
+    const bool converged = processorRef.isConverged();
+    const double msPerSample = processorRef.getSampleRate() > 0.0 ? 1000.0 / processorRef.getSampleRate() : 0.0;
+    bool changed = numTargets != shownNumTargets || converged != shownConverged;
+
+    for (int channel = 0; channel < numTargets; ++channel)
+    {
+        const auto i = static_cast<size_t>(channel);
+        const float confidence = processorRef.getConfidence(channel);
+        const int delay = juce::roundToInt(100.0 * msPerSample * processorRef.getDelaySamples(channel));
+        const int roundedConfidence = confidence > CorrelationKernels::minConfidenceDb ? juce::roundToInt(confidence) : noConfidence;
+        changed = changed || delay != shownDelays[i] || roundedConfidence != shownConfidences[i];
+        shownDelays[i] = delay;
+        shownConfidences[i] = roundedConfidence;
+    }
+
+    if (! changed)
+        return;
+
+    shownNumTargets = numTargets;
+    shownConverged = converged;
+
+    juce::StringArray delays, confidences;
+    for (size_t i = 0; i < static_cast<size_t>(numTargets); ++i)
+    {
+        delays.add(juce::String(shownDelays[i] / 100.0, 2));
+        confidences.add(shownConfidences[i] != noConfidence ? juce::String(shownConfidences[i]) : juce::String("--"));
+    }
+
+    delayLabel.setText(delays.joinIntoString(" / ") + " ms   " + confidences.joinIntoString(" / ") + " dB"
+                       + (converged ? "   locked" : ""), juce::dontSendNotification);
+}
+
+bool AudioPluginAudioProcessorEditor::updatePpqWindow()
+{
+    // Returns true if the window drawn into the static layer is out of date
+    auto* leftPPQ = processorRef.getValueTreeState().getRawParameterValue("leftPPQ");
+    auto* rightPPQ = processorRef.getValueTreeState().getRawParameterValue("rightPPQ");
+    const bool showWindow = leftPPQ && rightPPQ && processorRef.getTrigger() == Params::Trigger::ppqWindow;
+    const float left = showWindow ? leftPPQ->load() : -1.0f;
+    const float right = showWindow ? rightPPQ->load() : -1.0f;
+
+    if (showWindow == drawnPpqWindow && juce::approximatelyEqual(left, drawnLeftPPQ) && juce::approximatelyEqual(right, drawnRightPPQ))
+        return false;
+
+    drawnPpqWindow = showWindow;
+    drawnLeftPPQ = left;
+    drawnRightPPQ = right;
+    return true;
 }
 
 void AudioPluginAudioProcessorEditor::mouseDrag(const juce::MouseEvent& event)
@@ -168,7 +367,7 @@ void AudioPluginAudioProcessorEditor::mouseDrag(const juce::MouseEvent& event)
         rightParam->setValueNotifyingHost(newRight);
     }
 
-    repaint();
+    // The next vblank sees the moved bar and redraws the static layer
 }
 
 void AudioPluginAudioProcessorEditor::mouseDown(const juce::MouseEvent& event)
@@ -202,5 +401,9 @@ void AudioPluginAudioProcessorEditor::sliderValueChanged(juce::Slider* slider)
     if (slider == &learningRateSlider)
     {
         processorRef.setLearningRate((float)learningRateSlider.getValue());
+
+        // The value text is part of the static layer
+        staticLayerScale = 0.0f;
+        repaint(learningRateSlider.getBounds().withTrimmedTop(learningRateSlider.getHeight() - 4).withHeight(16));
     }
 }
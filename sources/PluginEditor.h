@@ -1,9 +1,14 @@
 #pragma once
 
 #include "PluginProcessor.h"
+#include "WaveformColumns.h"
 
 //==============================================================================
-class AudioPluginAudioProcessorEditor final : public juce::AudioProcessorEditor, private juce::Timer, public juce::Slider::Listener
+// The background, separator, slider value and PPQ window are rendered once into
+// staticLayer and blitted. Each vblank the editor repaints only the waveform
+// columns the processor wrote since the last frame, the old and new playhead,
+// and the delay label when its text changes.
+class AudioPluginAudioProcessorEditor final : public juce::AudioProcessorEditor, public juce::Slider::Listener
 {
 public:
     explicit AudioPluginAudioProcessorEditor (AudioPluginAudioProcessor&);
@@ -18,7 +23,15 @@ public:
     void sliderValueChanged(juce::Slider* slider) override;
 
 private:
-    void timerCallback() override;
+    void onVBlank();
+    void drawStaticLayer(juce::Graphics& g);
+    void drawWaveform(juce::Graphics& g, juce::Rectangle<int> clip);
+    void updateDelayLabel();
+    bool updatePpqWindow();
+    int getPlayheadX() const;
+    juce::Rectangle<int> getProfilerOverlayArea() const;
+    void drawProfilerOverlay(juce::Graphics& g);
+    void dumpProfile();
     juce::Colour getChannelColour(int channelIndex)
     {
         switch (channelIndex)
@@ -37,7 +50,25 @@ private:
     bool draggingRight = false;
     juce::Slider learningRateSlider;
     juce::Rectangle<int> waveformAreaRect;
+    WaveformColumns waveformColumns;    // Min/max per pixel column, refreshed only where the processor wrote
+    juce::Image staticLayer;            // Everything behind the waveform, at the display's pixel scale
+    float staticLayerScale = 0.0f;      // Zero when staticLayer needs redrawing
+    float drawnLeftPPQ = -1.0f;         // PPQ window baked into staticLayer
+    float drawnRightPPQ = -1.0f;
+    bool drawnPpqWindow = false;
+    int lastPlayheadX = -1;
+    std::array<int, Params::maxTargetChannels> shownDelays {};         // In the delay label: hundredths of a millisecond
+    std::array<int, Params::maxTargetChannels> shownConfidences {};    // Whole dB, or noConfidence for "--"
+    int shownNumTargets = -1;
+    bool shownConverged = false;
+    static constexpr int noConfidence = std::numeric_limits<int>::min();
+    double lastOverlayMs = 0.0;
+    static constexpr double overlayIntervalMs = 1000.0 / 30.0;  // The profiler text is refreshed at the old timer rate
+    juce::TextButton statsButton { "Stats" };
+    juce::TextButton dumpButton { "Dump..." };
+    std::unique_ptr<juce::FileChooser> dumpChooser;
     float controlPanelRatio = 1.0f / 8.0f;
     AudioPluginAudioProcessor& processorRef;
+    juce::VBlankAttachment vBlankAttachment;    // Last, so it detaches before anything it touches goes
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioPluginAudioProcessorEditor)
 };
@@ -15,10 +15,14 @@ AudioPluginAudioProcessor::AudioPluginAudioProcessor()
                        ),
                     parameters(*this, nullptr, "PARAMETERS", createParameterLayout())
 {
+    parameters.addParameterListener("lookahead", this);
 }
 
 AudioPluginAudioProcessor::~AudioPluginAudioProcessor()
 {
+    parameters.removeParameterListener("lookahead", this);
+    cancelPendingUpdate();
+    analysisWorker.stop();
 }
 
 //==============================================================================
@@ -97,6 +101,18 @@ juce::AudioProcessorValueTreeState::ParameterLayout AudioPluginAudioProcessor::c
         "rightPPQ", "Right PPQ", rightPPQMin, rightPPQMax, rightPPQDefault));
     params.push_back(std::make_unique<juce::AudioParameterFloat>(
         "learningRate", "Learning Rate", learningRateMin, learningRateMax, learningRateDefault));
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        "estimator", "Estimator", estimatorChoices, estimatorDefault));
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        "channelMode", "Channel Mode", channelModeChoices, channelModeDefault));
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        "trigger", "Analysis Trigger", triggerChoices, triggerDefault));
+    params.push_back(std::make_unique<juce::AudioParameterBool>(
+        "longRange", "Long-Range Search", longRangeDefault));
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        "lowBand", "Low-Band Analysis", lowBandChoices, lowBandDefault));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        "lookahead", "Lookahead (ms)", lookaheadMsMin, lookaheadMsMax, lookaheadMsDefault));
 
     return { params.begin(), params.end() };
 }
@@ -108,8 +124,9 @@ bool AudioPluginAudioProcessor::isBusesLayoutSupported (const BusesLayout& layou
     juce::ignoreUnused (layouts);
     return true;
   #else
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Mono, stereo or a discrete multichannel bus; each channel gets its own delay in per-channel mode
+    const int numOutputChannels = layouts.getMainOutputChannelSet().size();
+    if (numOutputChannels < 1 || numOutputChannels > Params::maxTargetChannels)
         return false;
 
     // This checks if the input layout matches the output layout
@@ -133,42 +150,117 @@ void AudioPluginAudioProcessor::clearExtraOutputChannels (juce::AudioBuffer<floa
 
 void AudioPluginAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    juce::ignoreUnused (samplesPerBlock);
-
-    // Number of channels
-    int numChannels = getTotalNumOutputChannels();
+    samplesPerBlock = juce::jmax(1, samplesPerBlock);
+    preparedBlockSize = samplesPerBlock; // Longer host blocks are split into pieces of this size
 
     // Initialize the display buffer based on the sample rate and BPM
     double bpm = 120.0; // Example BPM, you might want to fetch this from host or a parameter later
     int samplesPerBeat = static_cast<int>((60.0 / bpm) * sampleRate); // Compute number of samples for 1 beat
-    displayBuffer.setSize(numChannels, samplesPerBeat, false, true, true); // Allocate the buffer: numChannels x samplesPerBeat
-    displayBuffer.clear(); // Clear buffer to avoid garbage values
+    int maxSamplesPerBeat = static_cast<int>((60.0 / Params::displayMinBpm) * sampleRate); // One beat at the slowest supported tempo
+    displayBuffer.prepare(numDisplaySources, maxSamplesPerBeat); // Allocate once: tempo changes only move the logical length
+    displayBuffer.setLength(samplesPerBeat);
+    displayBufferBpm = -1.0; // Pick up the host tempo on the next block
 
     // Initialize the delay line
     int maxDelaySamples = static_cast<int>(sampleRate / audioPluginCutOffFrequency); // Maximum delay in samples
-    delayLine.reset(); // Reset the delay line
-    delayLine.prepare({ sampleRate, (juce::uint32)samplesPerBlock, 1 }); // Prepare the delay line
-    delayLine.setMaximumDelayInSamples(maxDelaySamples); // Set maximum delay size
-    delayLine.setDelay(0.0f); // Start with no delay
-
-    // Initialize the analysis buffer
-    const int analysisBufferSize = juce::nextPowerOfTwo(maxDelaySamples); // Size of the analysis buffer
-    analysisBuffer.setSize(numChannels, analysisBufferSize); // Allocate the analysis buffer
-    analysisBuffer.clear(); // Clear the analysis buffer to avoid garbage values
-    analysisBufferWritePos = 0; // Reset the write position for the analysis buffer
+    maxWindowDelaySamples = maxDelaySamples;
+    int maxLongRangeDelaySamples = static_cast<int>(longRangeMaxDelayMs * sampleRate / 1000.0); // Maximum delay in long-range mode
+    int maxLookaheadSamples = static_cast<int>(std::ceil(Params::lookaheadMsMax * sampleRate / 1000.0)); // Largest fixed offset
+    int crossfadeSamples = static_cast<int>(delayCrossfadeMs * sampleRate / 1000.0); // Length of a delay change
+    int numMainChannels = juce::jlimit(1, Params::maxTargetChannels, getMainBusNumInputChannels()); // Delayed together in stereo mode
+    for (size_t i = 0; i < delayLines.size(); ++i)
+        delayLines[i].prepare(i == 0 ? numMainChannels : 1, juce::jmax(maxDelaySamples, maxLongRangeDelaySamples) + maxLookaheadSamples, samplesPerBlock, crossfadeSamples); // Sized for every mode, so switching never reallocates
+    analysisTap.setSize(Params::maxTargetChannels, samplesPerBlock); // The input the analysis sees, one channel per target
+    monoTap.setSize(2, samplesPerBlock); // Mono input and sidechain mixes for stereo mode
+
+    // Initialize the analysis worker and estimators
+    const int analysisBufferSize = juce::nextPowerOfTwo(maxDelaySamples); // Size of the analysis window
+    const int maxNumTargets = juce::jlimit(1, Params::maxTargetChannels, getMainBusNumInputChannels()); // Targets in per-channel mode
+    analysisWorker.stop(); // The worker thread must not run while its buffers are resized
+    crossCorrelator.prepare(analysisBufferSize, crossCorrelationDecimation); // Preallocate the decimated coarse-search buffers
+    gccPhat.prepare(analysisBufferSize, maxNumTargets); // Preallocate the GCC-PHAT FFT plan, spectra and one accumulator per target
+    gccPhat.setSmoothing(crossSpectrumSmoothing); // Weight of each new segment in the running cross-spectrum
+    phaseSlope.prepare(analysisBufferSize); // Preallocate the phase-slope FFT plan and spectra
+    const int longRangeDecimation = juce::jmax(1, juce::roundToInt(sampleRate / longRangeAnalysisRate)); // Coarse-search decimation
+    longRange.prepare(maxLongRangeDelaySamples, longRangeDecimation, longRangePartitionSize, maxNumTargets); // Preallocate the histories and partition spectra
+    longRange.setSmoothing(crossSpectrumSmoothing); // Same running average as GCC-PHAT
+    for (size_t i = 0; i < lowBandWindows.size(); ++i)
+        lowBandWindows[i].prepare(4 << i, analysisBufferSize, maxNumTargets); // Decimated copies of the analysis window
+    activeLowBandWindow = nullptr;
+    analysisWorker.prepare(analysisBufferSize, samplesPerBlock, maxNumTargets); // Allocate the FIFO and analysis window
+    for (auto& flag : newDelayAvailable)
+        flag.store(false);
+    for (auto& confidence : delayConfidence)
+        confidence.store(CorrelationKernels::minConfidenceDb);
+    for (auto& tracker : delayTrackers)
+        tracker.prepare(sampleRate, static_cast<float>(delayToleranceMs * sampleRate / 1000.0), convergenceSeconds); // Locks within the delay tolerance
+    samplesSinceEstimate = 0;
+    samplesAnalysed = 0;
+    lastMeasurement = -1;
+    numTargetsEstimated = 1;
+    analysisConverged.store(false);
+    numTargetsPushed = 1;
+    onsetDetector.prepare(sampleRate); // Envelope coefficients for this rate
+    onsetWindowSamples = analysisBufferSize; // One full analysis window per onset
+    longRangeOnsetWindowSamples = longRange.getSamplesForFirstEstimate(); // The whole search range per onset
+    onsetSamplesRemaining = 0;
+    numOnsets = 0;
+    analysisStreamOpen = false;
+    profiler.reset(); // Neither the audio nor the analysis thread is running here
 
     // Retrieve and store parameter pointers
     leftPPQBound  = parameters.getRawParameterValue("leftPPQ"); // Pointer to the left PPQ parameter
     rightPPQBound = parameters.getRawParameterValue("rightPPQ"); // Pointer to the right PPQ parameter
+    estimatorType = parameters.getRawParameterValue("estimator"); // Pointer to the estimator choice parameter
+    channelModeType = parameters.getRawParameterValue("channelMode"); // Pointer to the channel mode parameter
+    processedChannelMode = getChannelMode(); // The delay lines were just cleared
+    triggerType = parameters.getRawParameterValue("trigger"); // Pointer to the analysis trigger parameter
+    longRangeFlag = parameters.getRawParameterValue("longRange"); // Pointer to the long-range search parameter
+    lowBandType = parameters.getRawParameterValue("lowBand"); // Pointer to the low-band analysis parameter
+    lookaheadMs = parameters.getRawParameterValue("lookahead"); // Pointer to the lookahead parameter
+
+    // Report the latency before the first block, and start the delay lines at the offset the host now compensates for
+    const int lookahead = computeLookaheadSamples(sampleRate);
+    cancelPendingUpdate();
+    setLatencySamples(lookahead);
+    reportedLookaheadSamples.store(lookahead);
+    lookaheadSamples.store(lookahead);
+    for (auto& delayLine : delayLines)
+        delayLine.setCurrentAndTargetDelay(static_cast<float>(lookahead));
+    analysisOffsetSamples.store(computeAnalysisOffset());
+
+    // A restored project starts aligned: the saved delays go straight to the delay lines, without a fade in from zero
+    {
+        const juce::ScopedLock lock(analysisStateLock);
+        applyWarmStart();
+        accumulatedOffset = getAnalysisOffset(); // The restored spectrum was saved behind the same offset
+    }
+    for (int channel = 0; channel < Params::maxTargetChannels; ++channel)
+        if (newDelayAvailable[static_cast<size_t>(channel)].exchange(false))
+            updateDelay(delaySamples[static_cast<size_t>(channel)].load(), channel, false);
+    isPrepared.store(true);
+
+    analysisWorker.start(); // Start estimating on the analysis thread
 }
 
 void AudioPluginAudioProcessor::releaseResources()
 {
-    displayBuffer.clear();
-    analysisBuffer.clear();
-    delayLine.reset();
+    isPrepared.store(false);
+    analysisWorker.stop();
+    crossCorrelator.reset();
+    gccPhat.reset();
+    phaseSlope.reset();
+    longRange.reset();
+    for (auto& delayLine : delayLines)
+        delayLine.reset();
     leftPPQBound = nullptr;
     rightPPQBound = nullptr;
+    estimatorType = nullptr;
+    channelModeType = nullptr;
+    triggerType = nullptr;
+    longRangeFlag = nullptr;
+    lowBandType = nullptr;
+    lookaheadMs = nullptr;
 }
 
 void AudioPluginAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
@@ -177,61 +269,178 @@ void AudioPluginAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
     juce::ignoreUnused(midiMessages);
     juce::ScopedNoDenormals noDenormals;
     clearExtraOutputChannels(buffer);
+    applyLookahead();
+
+    // Everything below is sized for the block size the host announced. A host that goes over it gets
+    // its block processed in pieces of that size, so the audio thread never has to allocate.
+    const int numSamples = buffer.getNumSamples();
+    for (int start = 0; start < numSamples; start += preparedBlockSize)
+    {
+        juce::AudioBuffer<float> piece(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), start, juce::jmin(preparedBlockSize, numSamples - start));
+        blockOffset = start;
+        processPiece(piece);
+    }
+
+    blockOffset = 0;
+}
 
+void AudioPluginAudioProcessor::processPiece(juce::AudioBuffer<float>& buffer)
+{
     auto input = getBusBuffer(buffer, true, 0);
     auto sidechain = getBusBuffer(buffer, true, 1);
     auto output = getBusBuffer(buffer, false, 0);
 
-    processAudio(input, sidechain, output);
-    updateUI(input, sidechain);
+    // Each stage's budget is the real-time length of the block
+    const double blockSeconds = buffer.getNumSamples() / getSampleRate();
+    {
+        StageProfiler::ScopedTimer timer(profiler, StageProfiler::Stage::processAudio, blockSeconds);
+        processAudio(input, sidechain, output);
+    }
 
-    // Compute new delay if host is playing
-    if (auto* playhead = getPlayHead())
+    // From here on only the mono views are needed, whatever the output carries: the display shows the corrected
+    // input, the analysis the input as it arrived
     {
-        if (auto position = playhead->getPosition())
-        {
-            if (auto isPlaying = position->getIsPlaying())
-            {
-                if (auto ppq = position->getPpqPosition())
-                {
-                    double fractionalBeat = *ppq - std::floor(*ppq);
-                    if (fractionalBeat > *leftPPQBound && fractionalBeat < *rightPPQBound && leftPPQBound != nullptr && rightPPQBound != nullptr)
-                    {
-                        int delay = findDelay(input, sidechain);
-                        delaySamples.store(delay);
-                        updateDelay(delay);
-                    }
-                    else
-                    {
-                        analysisBuffer.clear();
-                        analysisBufferWritePos = 0;
-                    }
-                }
-            }
-        }
+        StageProfiler::ScopedTimer timer(profiler, StageProfiler::Stage::updateUI, blockSeconds);
+        updateUI(displayInput, analysisSidechain);
     }
+
+    // Compute new delay inside the PPQ window while the host plays, or after sidechain onsets
+    if (getTrigger() == Params::Trigger::onset)
+        triggerOnOnsets(analysisInput, analysisSidechain);
+    else
+        triggerOnPpqWindow(analysisInput, analysisSidechain);
+
+    // Apply the latest estimates published by the analysis thread
+    for (int channel = 0; channel < Params::maxTargetChannels; ++channel)
+        if (newDelayAvailable[static_cast<size_t>(channel)].exchange(false))
+            updateDelay(delaySamples[static_cast<size_t>(channel)].load(), channel);
 }
 
 //==============================================================================
 void AudioPluginAudioProcessor::processAudio(juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& sidechain, juce::AudioBuffer<float>& output)
 {
-    // Convert stereo to mono
-    stereoToMono(input);
+    const int numTargets = getNumTargets(input);
+    numActiveTargets.store(numTargets);
+
+    // The lines are shared between modes, and their channels hold different signals in each.
+    // Left alone, the first delay's worth of output after a switch would replay audio from the last time the mode was used.
+    const auto channelMode = getChannelMode();
+    if (channelMode != processedChannelMode)
+    {
+        for (auto& delayLine : delayLines)
+            delayLine.clearHistory();
+        processedChannelMode = channelMode;
+        analysisWorker.requestReset(); // The analysed input restarts from silence too
+    }
+
+    // Another lookahead or search range moves the lags the analysis can see; windows in flight were read elsewhere
+    const int analysisOffset = computeAnalysisOffset();
+    if (analysisOffset != analysisOffsetSamples.load())
+    {
+        analysisOffsetSamples.store(analysisOffset);
+        analysisWorker.requestReset();
+    }
+
+    const int numSamples = input.getNumSamples();
+    if (channelMode == Params::ChannelMode::stereo)
+    {
+        // Every main channel through one delay, in place: the main output shares the input's channels, so nothing is copied
+        delayLines[0].process(input.getArrayOfWritePointers(), input.getNumChannels(), numSamples);
+
+        // Only the analysis and the display see mono mixes; the buses keep every channel
+        mixAnalysisTap(input, sidechain);
+        tapAnalysisInput(delayLines[0], input.getNumChannels(), 0, numSamples);
+        analysisInput.setDataToReferTo(analysisTap.getArrayOfWritePointers(), input.getNumChannels() > 0 ? 1 : 0, numSamples);
+        return;
+    }
+
+    // The sidechain is always the single reference
     stereoToMono(sidechain);
 
-    // Delay input
-    auto* channelData = input.getWritePointer(0);
-    for (int i = 0; i < input.getNumSamples(); ++i)
+    // The other modes display the bus buffers themselves
+    displayInput.setDataToReferTo(input.getArrayOfWritePointers(), input.getNumChannels(), numSamples);
+    analysisSidechain.setDataToReferTo(sidechain.getArrayOfWritePointers(), sidechain.getNumChannels(), numSamples);
+
+    if (channelMode == Params::ChannelMode::perChannel)
     {
-        float inputSample = channelData[i];
-        float delayedSample = delayLine.popSample(0);
-        delayLine.pushSample(0, inputSample);
-        channelData[i] = delayedSample;
+        // Delay every input channel independently, one vectorised pass per channel and block.
+        // Only channels present on both buses: an input without an output has nowhere to go.
+        const int numChannels = juce::jmin(numTargets, input.getNumChannels(), output.getNumChannels());
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto& delayLine = delayLines[static_cast<size_t>(channel)];
+            delayLine.process(input.getArrayOfWritePointers() + channel, 1, numSamples);
+            copyBuffer(input, channel, output, channel, 0, output.getNumSamples());
+            tapAnalysisInput(delayLine, 1, channel, numSamples);
+        }
+
+        analysisInput.setDataToReferTo(analysisTap.getArrayOfWritePointers(), numChannels, numSamples);
+        return;
     }
 
-    // Copy mono input to stereo output
-    copyBuffer(input, 0, output, 0, 0, output.getNumSamples());
-    copyBuffer(input, 0, output, 1, 0, output.getNumSamples());
+    // Convert stereo to mono
+    stereoToMono(input);
+
+    // Delay input, one vectorised pass per block
+    delayLines[0].process(input.getArrayOfWritePointers(), 1, numSamples);
+    tapAnalysisInput(delayLines[0], 1, 0, numSamples);
+    analysisInput.setDataToReferTo(analysisTap.getArrayOfWritePointers(), juce::jmin(1, input.getNumChannels()), numSamples);
+
+    // Copy mono input to every output channel
+    for (int channel = 0; channel < output.getNumChannels(); ++channel)
+        copyBuffer(input, 0, output, channel, 0, output.getNumSamples());
+}
+
+void AudioPluginAudioProcessor::tapAnalysisInput(const FractionalDelayLine& delayLine, int numChannels, int tapChannel, int numSamples)
+{
+    // The analysis measures the input before its correction. Measuring the corrected output instead would add
+    // the applied delay to every estimate, and applying that as the new delay would never stop growing.
+    // The fixed offset keeps the lags it has to find inside the estimators' range.
+    numChannels = juce::jmin(numChannels, delayLine.getNumChannels());
+    if (numChannels <= 0)
+        return;
+
+    float* destination = analysisTap.getWritePointer(tapChannel);
+    const int offset = getAnalysisOffset();
+    const float gain = 1.0f / (float) numChannels;
+    juce::FloatVectorOperations::copyWithMultiply(destination, delayLine.getInput(0, numSamples, offset), gain, numSamples);
+    for (int ch = 1; ch < numChannels; ++ch)
+        juce::FloatVectorOperations::addWithMultiply(destination, delayLine.getInput(ch, numSamples, offset), gain, numSamples);
+}
+
+void AudioPluginAudioProcessor::mixAnalysisTap(const juce::AudioBuffer<float>& input, const juce::AudioBuffer<float>& sidechain)
+{
+    const int numSamples = input.getNumSamples();
+    jassert(numSamples <= monoTap.getNumSamples()); // processBlock() splits longer blocks
+
+    mixToMono(input, monoTap.getWritePointer(0), numSamples);
+    mixToMono(sidechain, monoTap.getWritePointer(1), numSamples);
+
+    // A bus without channels stays empty, so the triggers still see a missing sidechain
+    float* const* tap = monoTap.getArrayOfWritePointers();
+    displayInput.setDataToReferTo(tap, input.getNumChannels() > 0 ? 1 : 0, numSamples);
+    analysisSidechain.setDataToReferTo(tap + 1, sidechain.getNumChannels() > 0 ? 1 : 0, numSamples);
+}
+
+void AudioPluginAudioProcessor::mixToMono(const juce::AudioBuffer<float>& source, float* destination, int numSamples)
+{
+    // One read per channel and one write of the mix, leaving the source untouched
+    const int numChannels = source.getNumChannels();
+    if (numChannels == 0 || numSamples <= 0)
+        return;
+
+    const float gain = 1.0f / (float) numChannels;
+    juce::FloatVectorOperations::copyWithMultiply(destination, source.getReadPointer(0), gain, numSamples);
+    for (int ch = 1; ch < numChannels; ++ch)
+        juce::FloatVectorOperations::addWithMultiply(destination, source.getReadPointer(ch), gain, numSamples);
+}
+
+int AudioPluginAudioProcessor::getNumTargets(const juce::AudioBuffer<float>& input) const
+{
+    if (getChannelMode() != Params::ChannelMode::perChannel)
+        return 1;
+
+    return juce::jlimit(1, Params::maxTargetChannels, input.getNumChannels());
 }
 
 void AudioPluginAudioProcessor::updateUI(juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& sidechain)
@@ -245,12 +454,14 @@ void AudioPluginAudioProcessor::updateUI(juce::AudioBuffer<float>& input, juce::
                 updateDisplayBufferIfNeeded(*bpm);
             }
 
-            if (auto ppq = position->getPpqPosition())
+            if (auto ppq = getPpqPosition(*position))
             {
                 int index = getIndexFromPpq(*ppq);
                 playheadIndex.store(index);
-                copyBuffer(input, 0, displayBuffer, 0, index, input.getNumSamples(), true);
-                copyBuffer(sidechain, 0, displayBuffer, 1, index, sidechain.getNumSamples(), true);
+
+                const float* sources[] = { input.getNumChannels() > 0 ? input.getReadPointer(0) : nullptr,
+                                           sidechain.getNumChannels() > 0 ? sidechain.getReadPointer(0) : nullptr };
+                displayBuffer.writeBlock(sources, numDisplaySources, index, input.getNumSamples());
             }
         }
     }
@@ -264,18 +475,28 @@ void AudioPluginAudioProcessor::updateDisplayBufferIfNeeded(double bpm)
         displayBufferBpm = bpm;
 
         int samplesPerBeat = static_cast<int>((60.0 / bpm) * getSampleRate());
-        int numChannels = getTotalNumOutputChannels();
 
-        displayBuffer.setSize(numChannels, samplesPerBeat, false, true, true);
-        displayBuffer.clear();
+        // Preallocated storage: this only changes the logical length, clamped at the slowest supported tempo
+        displayBuffer.setLength(samplesPerBeat);
     }
 }
 
+juce::Optional<double> AudioPluginAudioProcessor::getPpqPosition(const juce::AudioPlayHead::PositionInfo& position) const
+{
+    // The host reports where its block starts; a later piece of a split block starts blockOffset samples on
+    auto ppq = position.getPpqPosition();
+    if (ppq && blockOffset > 0)
+        if (auto bpm = position.getBpm())
+            ppq = *ppq + blockOffset * *bpm / (60.0 * getSampleRate());
+
+    return ppq;
+}
+
 int AudioPluginAudioProcessor::getIndexFromPpq(double ppqPosition) const
 {
     double fractionalBeat = ppqPosition - std::floor(ppqPosition); // range [0.0, 1.0)
 
-    int bufferLength = displayBuffer.getNumSamples();
+    int bufferLength = displayBuffer.getLength();
     int index = static_cast<int>(fractionalBeat * bufferLength);
 
     // Safety clamp in case of rounding errors
@@ -315,156 +536,436 @@ void AudioPluginAudioProcessor::copyBuffer(const juce::AudioBuffer<float>& src,
         dst.copyFrom(dstChannel, 0, src, srcChannel, firstChunk, secondChunk);
 }
 
-int AudioPluginAudioProcessor::findDelay(juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& sidechain)
+void AudioPluginAudioProcessor::triggerOnPpqWindow(const juce::AudioBuffer<float>& input, const juce::AudioBuffer<float>& sidechain)
 {
-    copyBuffer(sidechain, 0, analysisBuffer, 0, analysisBufferWritePos, input.getNumSamples(), true);
-    copyBuffer(input, 0, analysisBuffer, 1, analysisBufferWritePos, input.getNumSamples(), true);
-    analysisBufferWritePos = (analysisBufferWritePos + input.getNumSamples()) % analysisBuffer.getNumSamples();
+    if (auto* playhead = getPlayHead())
+    {
+        if (auto position = playhead->getPosition())
+        {
+            if (auto isPlaying = position->getIsPlaying())
+            {
+                if (auto ppq = getPpqPosition(*position))
+                {
+                    double fractionalBeat = *ppq - std::floor(*ppq);
+                    // Once converged, the beats in between cannot change the result
+                    const auto beat = static_cast<juce::int64>(std::floor(*ppq));
+                    const bool throttled = analysisConverged.load() && beat % convergedBeatInterval != 0;
+
+                    // A long-range segment needs more contiguous audio than most PPQ windows last, and every
+                    // reset would discard it, so that search analyses the whole beat, every beat
+                    const bool inWindow = isLongRangeSearch()
+                                       || (fractionalBeat > *leftPPQBound && fractionalBeat < *rightPPQBound && leftPPQBound != nullptr && rightPPQBound != nullptr && ! throttled);
 
-    const int numSamples = analysisBuffer.getNumSamples();
-    const float* ref = analysisBuffer.getReadPointer(0);
-    const float* target = analysisBuffer.getReadPointer(1);
-    return crossCorrelation(ref, target, numSamples, numSamples, crossCorrelationStepSize);
-    //return fftPhaseDelay(analysisBuffer);
+                    if (inWindow)
+                    {
+                        pushAnalysisBlock(input, sidechain);
+                    }
+                    else
+                    {
+                        endAnalysisStream();
+                    }
+                }
+            }
+        }
+    }
 }
 
-void AudioPluginAudioProcessor::updateDelay(int delay)
+void AudioPluginAudioProcessor::triggerOnOnsets(const juce::AudioBuffer<float>& input, const juce::AudioBuffer<float>& sidechain)
 {
-    if (std::abs(delay) > (delayToleranceMs * getSampleRate() / 1000.0f))
+    // Needs no transport: each sidechain transient opens one analysis window, starting with the block it falls in
+    if (sidechain.getNumChannels() == 0)
+        return;
+
+    const int onsetIndex = onsetDetector.process(sidechain.getReadPointer(0), sidechain.getNumSamples());
+    if (onsetIndex >= 0 && onsetSamplesRemaining <= 0)
     {
-        // Gradient descent
-        float currentDelay = delayLine.getDelay();
-        float error = delay - currentDelay;
-        auto* learningRateParam = parameters.getRawParameterValue("learningRate");
-        float learningRate = learningRateParam != nullptr ? static_cast<float>(*learningRateParam) : 0.25f;
-        float newDelay = currentDelay + learningRate * error;
+        // Once converged, the onsets in between cannot change the result
+        ++numOnsets;
+        if (! analysisConverged.load() || numOnsets % convergedBeatInterval == 0)
+            onsetSamplesRemaining = isLongRangeSearch() ? longRangeOnsetWindowSamples : onsetWindowSamples;
+    }
 
-        // Ensure the new delay is within bounds
-        newDelay = static_cast<float>(static_cast<int>(newDelay) % delayLine.getMaximumDelayInSamples());
-        //newDelay = std::clamp(newDelay, 0.0f, static_cast<float>(delayLine.getMaximumDelayInSamples()));
+    if (onsetSamplesRemaining > 0)
+    {
+        pushAnalysisBlock(input, sidechain);
+        onsetSamplesRemaining -= input.getNumSamples();
+    }
+    else
+    {
+        endAnalysisStream();
+    }
+}
+
+void AudioPluginAudioProcessor::pushAnalysisBlock(const juce::AudioBuffer<float>& input, const juce::AudioBuffer<float>& sidechain)
+{
+    // Audio thread: hand the mono sidechain (reference) and the input target channel(s) to the analysis thread
+    if (input.getNumChannels() == 0 || sidechain.getNumChannels() == 0)
+        return;
+
+    // Switching modes changes what the target channels mean, so start the analysis over
+    const int numTargets = getNumTargets(input);
+    if (numTargets != numTargetsPushed)
+    {
+        analysisWorker.requestReset();
+        numTargetsPushed = numTargets;
+    }
+
+    // Silence gate: without signal on the reference or on every target there is nothing to align
+    const int numSamples = input.getNumSamples();
+    const float threshold = juce::Decibels::decibelsToGain(silenceThresholdDb);
+    float targetLevel = 0.0f;
+    for (int t = 0; t < numTargets; ++t)
+        targetLevel = juce::jmax(targetLevel, input.getRMSLevel(t, 0, numSamples));
+
+    if (targetLevel < threshold || sidechain.getRMSLevel(0, 0, numSamples) < threshold)
+    {
+        endAnalysisStream(); // The stream resumes discontinuously
+        return;
+    }
+
+    analysisWorker.pushBlock(sidechain.getReadPointer(0), input.getArrayOfReadPointers(), numTargets, input.getNumSamples());
+    analysisStreamOpen = true;
+}
+
+void AudioPluginAudioProcessor::endAnalysisStream()
+{
+    // One reset per gap: only the first block after the last push breaks the stream
+    if (analysisStreamOpen)
+    {
+        analysisWorker.requestReset();
+        analysisStreamOpen = false;
+    }
+}
 
-        // Update the delay line with the new delay
-        delayLine.setDelay(newDelay);
+void AudioPluginAudioProcessor::analysisSamplesReceived(const float* ref, const float* const* targets, int numTargets, int numSamples)
+{
+    // Analysis thread: fold the stream into the running cross-spectra, one reference FFT per hop shared by all targets
+    const juce::ScopedLock lock(analysisStateLock);
+    samplesSinceEstimate += numSamples;
+    samplesAnalysed += numSamples;
+
+    // The running spectra hold lags behind the offset they were built with, so another offset starts them over
+    if (getAnalysisOffset() != accumulatedOffset)
+    {
+        gccPhat.resetAccumulator();
+        longRange.reset();
+        accumulatedOffset = getAnalysisOffset();
     }
+
+    // Low-band mode keeps a decimated copy of the window; a different factor starts its copy from scratch
+    const auto lowBand = getLowBand();
+    auto* lowBandWindow = lowBand == Params::LowBand::off ? nullptr : &lowBandWindows[static_cast<size_t>(lowBand) - 1];
+    if (lowBandWindow != nullptr && lowBandWindow != activeLowBandWindow)
+        lowBandWindow->reset();
+    activeLowBandWindow = lowBandWindow;
+
+    if (isLongRangeSearch())
+        longRange.pushSamples(ref, targets, numTargets, numSamples);
+    else if (activeLowBandWindow != nullptr)
+        activeLowBandWindow->pushSamples(ref, targets, numTargets, numSamples);
+    else if (getEstimator() == Params::Estimator::gccPhat)
+        gccPhat.pushSamples(ref, targets, numTargets, numSamples);
 }
 
-int AudioPluginAudioProcessor::crossCorrelation(const float* ref, const float* target, int numSamples, int maxLagSamples, int stepSize)
+void AudioPluginAudioProcessor::analysisWindowUpdated(const juce::AudioBuffer<float>& window, int numTargets)
 {
-    int bestLag = 0;
-    float bestCorrelation = -std::numeric_limits<float>::infinity();
+    // Analysis thread: publish the tracked delays for updateDelay() to pick up on the audio thread
+    const juce::ScopedLock lock(analysisStateLock);
+    numTargets = juce::jmin(numTargets, window.getNumChannels() - 1, Params::maxTargetChannels);
+
+    // Until the estimator moves on to new audio, another estimate would only repeat the last one
+    const auto measurement = getMeasurementIndex(window.getNumSamples());
+    if (measurement == lastMeasurement)
+        return;
+
+    lastMeasurement = measurement;
 
-    for (int lag = 0; lag <= maxLagSamples; lag += stepSize)
     {
-        float sum = 0.0f;
+        // An estimate slower than the window it covers cannot keep up with the stream
+        StageProfiler::ScopedTimer timer(profiler, StageProfiler::Stage::findDelay, window.getNumSamples() / getSampleRate());
+        findDelays(window, numTargets, analysisDelays.data(), analysisConfidences.data());
+    }
 
-        for (int i = 0; i < numSamples; ++i)
-        {
-            int tgtIndex = i + lag;
-            if (tgtIndex < numSamples)
-                sum += ref[i] * target[tgtIndex];
-        }
+    // The targets were analysed behind a fixed offset; removing it leaves lags in both directions
+    const float offset = static_cast<float>(getAnalysisOffset());
+    for (int t = 0; t < numTargets; ++t)
+        analysisDelays[static_cast<size_t>(t)] -= offset;
+
+    fuseEstimates(numTargets, measurement);
+}
+
+juce::int64 AudioPluginAudioProcessor::getMeasurementIndex(int windowSize) const
+{
+    // Analysis thread: the streaming estimators move on once per accumulated segment, the others every half
+    // window, the same hop as GCC-PHAT's. Picks the estimator in the same order as findDelays(), and
+    // interleaves the three counts so that switching estimators never repeats an index.
+    constexpr juce::int64 numSources = 3;
+    if (isLongRangeSearch())
+        return longRange.getSegmentCount() * numSources + 2;
+
+    const bool lowBandReady = activeLowBandWindow != nullptr && activeLowBandWindow->isFull();
+    if (! lowBandReady && getEstimator() == Params::Estimator::gccPhat && gccPhat.hasAccumulatedSpectrum())
+        return gccPhat.getSegmentCount() * numSources + 1;
+
+    return samplesAnalysed / juce::jmax(1, windowSize / 2) * numSources;
+}
 
-        if (sum > bestCorrelation)
+void AudioPluginAudioProcessor::fuseEstimates(int numTargets, juce::int64 measurement)
+{
+    // Analysis thread: every track moves on by the audio analysed since the last estimate, then takes in the new one.
+    // Converged once every track is locked.
+    if (numTargets != numTargetsEstimated)
+    {
+        for (auto& tracker : delayTrackers)
+            tracker.reset();
+        numTargetsEstimated = numTargets;
+    }
+
+    // The learning rate sets how fast the tracks follow, relative to its default
+    const float responsiveness = getLearningRate() / Params::learningRateDefault;
+    bool converged = true;
+
+    for (int t = 0; t < numTargets; ++t)
+    {
+        const auto i = static_cast<size_t>(t);
+        auto& tracker = delayTrackers[i];
+        tracker.setResponsiveness(responsiveness);
+        tracker.predict(samplesSinceEstimate);
+        delayConfidence[i].store(analysisConfidences[i]);
+
+        // A flat correlation peak says nothing about the delay, and an outlier is held back: keep the current one
+        const bool fused = analysisConfidences[i] >= minConfidenceDb && tracker.update(analysisDelays[i], analysisConfidences[i], measurement);
+        if (fused)
         {
-            bestCorrelation = sum;
-            bestLag = lag;
+            delaySamples[i].store(tracker.getDelay());
+            newDelayAvailable[i].store(true);
         }
+
+        converged = converged && tracker.isLocked();
     }
 
-    return bestLag;
+    analysisConverged.store(converged);
+    samplesSinceEstimate = 0;
 }
 
-int AudioPluginAudioProcessor::peakAlignment(const float* ref, const float* target, int numSamples)
+void AudioPluginAudioProcessor::analysisReset()
 {
-    int refMaxIdx = 0;
-    int targetMaxIdx = 0;
-    float refMax = -std::numeric_limits<float>::infinity();
-    float targetMax = -std::numeric_limits<float>::infinity();
+    // Analysis thread: the playhead left the PPQ window. The accumulated spectrum is kept for the next beat,
+    // only the half-assembled segment is dropped because the stream is no longer contiguous.
+    const juce::ScopedLock lock(analysisStateLock);
+    gccPhat.discardPartialSegment();
+    longRange.discardHistory();
+    if (activeLowBandWindow != nullptr)
+        activeLowBandWindow->reset();
+}
 
-    for (int i = 0; i < numSamples; ++i)
+float AudioPluginAudioProcessor::findDelay(const juce::AudioBuffer<float>& window)
+{
+    float delay = 0.0f;
+    float confidence = 0.0f;
+    findDelays(window, 1, &delay, &confidence);
+    return delay;
+}
+
+void AudioPluginAudioProcessor::findDelays(const juce::AudioBuffer<float>& window, int numTargets, float* delays, float* confidences)
+{
+    // Channel 0 of the window is the reference, channels 1 .. numTargets the targets
+    const int numSamples = window.getNumSamples();
+    const float* ref = window.getReadPointer(0);
+    const float* const* targets = window.getArrayOfReadPointers() + 1;
+
+    // Long-range mode reads its own decimated history instead of the window; no estimate until that has filled
+    if (isLongRangeSearch())
     {
-        if (ref[i] > refMax)
+        for (int t = 0; t < numTargets; ++t)
         {
-            refMax = ref[i];
-            refMaxIdx = i;
+            const bool hasEstimate = longRange.hasEstimate();
+            delays[t] = hasEstimate ? longRange.getDelay(longRange.getMaxLagSamples(), t) : 0.0f;
+            confidences[t] = hasEstimate ? longRange.getConfidence(t) : CorrelationKernels::minConfidenceDb;
         }
+        return;
+    }
 
-        if (target[i] > targetMax)
+    // Low-band mode, once the decimated copy spans a whole window
+    if (activeLowBandWindow != nullptr && activeLowBandWindow->isFull())
+    {
+        findLowBandDelays(window, numTargets, delays, confidences);
+        return;
+    }
+
+    if (getEstimator() == Params::Estimator::gccPhat && gccPhat.hasAccumulatedSpectrum())
+    {
+        for (int t = 0; t < numTargets; ++t)
         {
-            targetMax = target[i];
-            targetMaxIdx = i;
+            delays[t] = static_cast<float>(gccPhat.getAccumulatedDelay(numSamples, t));
+            confidences[t] = gccPhat.getConfidence(t);
         }
+        return;
     }
 
-    return targetMaxIdx - refMaxIdx;
+    estimateWindowDelays(ref, targets, numTargets, numSamples, delays, confidences);
 }
 
-int AudioPluginAudioProcessor::fftPhaseDelay(const juce::AudioBuffer<float>& buffer)
+void AudioPluginAudioProcessor::findLowBandDelays(const juce::AudioBuffer<float>& window, int numTargets, float* delays, float* confidences)
 {
-    // Use the minimum power of two for FFT size
-    int numSamples = buffer.getNumSamples();
-    int fftOrder = static_cast<int>(std::ceil(std::log2(numSamples)));
-    int fftSize = 1 << fftOrder;
+    // Coarse lags from the decimated window, at a fraction of the full-rate cost
+    const auto& lowBand = *activeLowBandWindow;
+    for (int t = 0; t < numTargets; ++t)
+        lowBandTargets[static_cast<size_t>(t)] = lowBand.getReadPointer(1 + t);
 
-    juce::dsp::FFT fft(fftOrder);
+    estimateWindowDelays(lowBand.getReadPointer(0), lowBandTargets.data(), numTargets, lowBand.getNumSamples(), delays, confidences);
 
-    // Prepare buffers (zero-padded)
-    juce::HeapBlock<juce::dsp::Complex<float>> refFFT(fftSize);
-    juce::HeapBlock<juce::dsp::Complex<float>> targetFFT(fftSize);
-    zeromem(refFFT, sizeof(juce::dsp::Complex<float>) * static_cast<size_t>(fftSize));
-    zeromem(targetFFT, sizeof(juce::dsp::Complex<float>) * static_cast<size_t>(fftSize));
+    // Full-rate refinement within one decimation step of each coarse lag keeps the result sample-accurate
+    const int factor = lowBand.getFactor();
+    const int numSamples = window.getNumSamples();
+    for (int t = 0; t < numTargets; ++t)
+    {
+        const int coarseLag = juce::roundToInt(delays[t] * static_cast<float>(factor));
+        const int fineStart = juce::jmax(0, coarseLag - factor);
+        const int fineEnd = juce::jmin(numSamples - 2, coarseLag + factor);
+        const int numOverlapping = numSamples - fineEnd - 1;
+        delays[t] = numOverlapping > 0 ? CorrelationKernels::refinePeak(window.getReadPointer(0), window.getReadPointer(1 + t), numOverlapping, fineStart, fineEnd)
+                                       : static_cast<float>(coarseLag);
+    }
+}
 
-    // Copy input to real part
-    auto* refData = buffer.getReadPointer(0);
-    auto* targetData = buffer.getReadPointer(1);
-    for (int i = 0; i < numSamples; ++i)
+void AudioPluginAudioProcessor::estimateWindowDelays(const float* ref, const float* const* targets, int numTargets, int numSamples, float* delays, float* confidences)
+{
+    switch (getEstimator())
     {
-        refFFT[i].real(refData[i]);
-        targetFFT[i].real(targetData[i]);
+        case Params::Estimator::gccPhat:
+            gccPhat.estimateDelays(ref, targets, numTargets, numSamples, numSamples, analysisLags.data());
+            for (int t = 0; t < numTargets; ++t)
+            {
+                delays[t] = static_cast<float>(analysisLags[static_cast<size_t>(t)]);
+                confidences[t] = gccPhat.getConfidence(t);
+            }
+            return;
+        case Params::Estimator::phaseSlope:
+            for (int t = 0; t < numTargets; ++t)
+            {
+                delays[t] = phaseSlope.estimateDelay(ref, targets[t], numSamples, numSamples);
+                confidences[t] = phaseSlope.getConfidence();
+            }
+            return;
+        case Params::Estimator::crossCorrelation:
+        default:
+            for (int t = 0; t < numTargets; ++t)
+            {
+                delays[t] = crossCorrelation(ref, targets[t], numSamples, numSamples);
+                confidences[t] = crossCorrelator.getConfidence();
+            }
+            return;
     }
+}
 
-    // Perform FFT in-place
-    fft.perform(refFFT, refFFT, false);
-    fft.perform(targetFFT, targetFFT, false);
+void AudioPluginAudioProcessor::updateDelay(float delay, int channel, bool crossfade)
+{
+    auto& delayLine = delayLines[static_cast<size_t>(channel)];
 
-    // Compute cross-spectrum and accumulate phase difference
-    double phaseSum = 0.0;
-    int phaseCount = 0;
+    // The tracker has already fused and smoothed the lags of the uncorrected input, so its lag is applied as is.
+    // A target delay samples late plays lookahead - delay behind the input, which the host's latency compensation
+    // turns into delay samples early. A lag outside the line's range is corrected as far as the range allows.
+    const float lookahead = static_cast<float>(lookaheadSamples.load());
+    const float newDelay = juce::jlimit(0.0f, static_cast<float>(delayLine.getMaximumDelayInSamples()), lookahead - delay);
 
-    for (int bin = 1; bin < fftSize / 2; ++bin) // skip DC
+    // Changes within the tolerance would only cost a crossfade
+    if (std::abs(newDelay - delayLine.getDelay()) > (delayToleranceMs * getSampleRate() / 1000.0))
     {
-        auto refC = refFFT[bin];
-        auto tgtC = targetFFT[bin];
+        // Crossfade the delay line to the new delay, or jump when nothing has been output yet
+        if (crossfade)
+            delayLine.setDelay(newDelay);
+        else
+            delayLine.setCurrentAndTargetDelay(newDelay);
+    }
+}
+
+int AudioPluginAudioProcessor::computeLookaheadSamples(double sampleRate) const
+{
+    // The smallest whole number of samples that covers the configured lookahead
+    return lookaheadMs != nullptr ? static_cast<int>(std::ceil(lookaheadMs->load() * sampleRate / 1000.0)) : 0;
+}
+
+void AudioPluginAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
+{
+    // May arrive on the audio thread, so the latency change is left to the message thread
+    juce::ignoreUnused(parameterID, newValue);
+    triggerAsyncUpdate();
+}
+
+void AudioPluginAudioProcessor::handleAsyncUpdate()
+{
+    // Message thread: report the new latency, then let the audio thread move the delay lines to it
+    if (! isPrepared.load())
+        return; // prepareToPlay() reports it
+
+    const int newLookahead = computeLookaheadSamples(getSampleRate());
+    if (newLookahead == reportedLookaheadSamples.load())
+        return;
+
+    setLatencySamples(newLookahead);
+    reportedLookaheadSamples.store(newLookahead);
+}
+
+int AudioPluginAudioProcessor::computeAnalysisOffset() const
+{
+    // The estimators find lags from 0 up to the search range. Reading the input this far behind the block moves
+    // that range to the lags updateDelay() can correct, from lookahead - range up to the lookahead.
+    const int range = isLongRangeSearch() ? longRange.getMaxLagSamples() : maxWindowDelaySamples;
+    return juce::jmax(0, range - lookaheadSamples.load());
+}
+
+void AudioPluginAudioProcessor::applyLookahead()
+{
+    // Audio thread: follow the latency the message thread reported
+    const int newLookahead = reportedLookaheadSamples.load();
+    const int oldLookahead = lookaheadSamples.load();
+    if (newLookahead == oldLookahead)
+        return;
 
-        float refMag = std::abs(refC);
-        float tgtMag = std::abs(tgtC);
+    // Move the fixed offset of every delay line and keep each channel's correction
+    for (auto& delayLine : delayLines)
+        delayLine.setDelay(delayLine.getDelay() - static_cast<float>(oldLookahead) + static_cast<float>(newLookahead));
 
-        if (refMag > 1e-6f && tgtMag > 1e-6f)
+    lookaheadSamples.store(newLookahead); // processAudio() moves the analysis offset with it
+}
+
+float AudioPluginAudioProcessor::crossCorrelation(const float* ref, const float* target, int numSamples, int maxLagSamples)
+{
+    // Coarse pass on decimated signals, full-rate refinement around the peak, parabolic sub-sample fit
+    return crossCorrelator.estimateDelay(ref, target, numSamples, maxLagSamples);
+}
+
+int AudioPluginAudioProcessor::peakAlignment(const float* ref, const float* target, int numSamples)
+{
+    int refMaxIdx = 0;
+    int targetMaxIdx = 0;
+    float refMax = -std::numeric_limits<float>::infinity();
+    float targetMax = -std::numeric_limits<float>::infinity();
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        if (ref[i] > refMax)
         {
-            float phaseRef = std::atan2(refC.imag(), refC.real());
-            float phaseTgt = std::atan2(tgtC.imag(), tgtC.real());
-            float phaseDiff = phaseTgt - phaseRef;
-
-            // Wrap to [-pi, pi]
-            while (phaseDiff > juce::MathConstants<float>::pi)
-                phaseDiff -= juce::MathConstants<float>::twoPi;
-            while (phaseDiff < -juce::MathConstants<float>::pi)
-                phaseDiff += juce::MathConstants<float>::twoPi;
-
-            // Estimate delay for this bin
-            float freq = (float)bin / fftSize; // normalized frequency
-            if (freq > 0.0f)
-            {
-                float delay = phaseDiff / (2.0f * juce::MathConstants<float>::pi * freq);
-                phaseSum += delay;
-                ++phaseCount;
-            }
+            refMax = ref[i];
+            refMaxIdx = i;
+        }
+
+        if (target[i] > targetMax)
+        {
+            targetMax = target[i];
+            targetMaxIdx = i;
         }
     }
 
-    // Average delay estimate
-    float avgDelay = (phaseCount > 0) ? static_cast<float>(phaseSum / phaseCount) : 0.0f;
-    return static_cast<int>(std::round(avgDelay));
+    return targetMaxIdx - refMaxIdx;
+}
+
+float AudioPluginAudioProcessor::fftPhaseDelay(const juce::AudioBuffer<float>& buffer)
+{
+    // The FFT plan and spectra live in phaseSlope, sized once in prepareToPlay
+    const int numSamples = buffer.getNumSamples();
+    return phaseSlope.estimateDelay(buffer.getReadPointer(0), buffer.getReadPointer(1), numSamples, numSamples);
 }
 
 void AudioPluginAudioProcessor::stereoToMono(juce::AudioBuffer<float>& buffer)
@@ -505,6 +1006,9 @@ void AudioPluginAudioProcessor::getStateInformation (juce::MemoryBlock& destData
     auto state = parameters.copyState();
     std::unique_ptr<juce::XmlElement> xml (state.createXml());
     copyXmlToBinary (*xml, destData);
+
+    // The learned delays follow the XML, so a reloaded project starts aligned
+    writeWarmStart(destData);
 }
 
 void AudioPluginAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
@@ -515,6 +1019,118 @@ void AudioPluginAudioProcessor::setStateInformation (const void* data, int sizeI
     {
         parameters.replaceState (juce::ValueTree::fromXml (*xmlState));
     }
+
+    readWarmStart(data, sizeInBytes);
+}
+
+//==============================================================================
+// Learned state chunk, appended after the XML:
+//   int version, double sampleRate, int numTargets,
+//   per target: bool tracking, bool locked, double delay, drift, p00, p01, p11,
+//   bool converged, then GccPhatEstimator::writeAccumulator(),
+// followed by a footer of int payloadSize and int warmStartMagic. Hosts and versions
+// without it simply load the parameters.
+void AudioPluginAudioProcessor::writeWarmStart(juce::MemoryBlock& destData)
+{
+    juce::MemoryOutputStream output(destData, true);
+    const auto payloadStart = output.getPosition();
+    {
+        const juce::ScopedLock lock(analysisStateLock);
+
+        // Restored but never prepared: nothing has been learned since, so pass the restored state on
+        if (! pendingWarmStart.isEmpty())
+        {
+            output.write(pendingWarmStart.getData(), pendingWarmStart.getSize());
+        }
+        else
+        {
+            output.writeInt(warmStartVersion);
+            output.writeDouble(getSampleRate());
+            output.writeInt(numTargetsEstimated);
+            for (int t = 0; t < numTargetsEstimated; ++t)
+            {
+                const auto tracker = delayTrackers[static_cast<size_t>(t)].getState();
+                output.writeBool(tracker.tracking);
+                output.writeBool(tracker.locked);
+                output.writeDouble(tracker.delay);
+                output.writeDouble(tracker.drift);
+                output.writeDouble(tracker.p00);
+                output.writeDouble(tracker.p01);
+                output.writeDouble(tracker.p11);
+            }
+            output.writeBool(analysisConverged.load());
+            gccPhat.writeAccumulator(output);
+        }
+    }
+
+    output.writeInt(static_cast<int>(output.getPosition() - payloadStart));
+    output.writeInt(warmStartMagic);
+}
+
+void AudioPluginAudioProcessor::readWarmStart(const void* data, int sizeInBytes)
+{
+    if (data == nullptr || sizeInBytes < 8)
+        return;
+
+    // Found from the end, so the XML part can have any length
+    const auto* bytes = static_cast<const char*>(data);
+    juce::MemoryInputStream footer(bytes + sizeInBytes - 8, 8, false);
+    const int payloadSize = footer.readInt();
+    if (footer.readInt() != warmStartMagic || ! juce::isPositiveAndNotGreaterThan(payloadSize, sizeInBytes - 8))
+        return;
+
+    const juce::ScopedLock lock(analysisStateLock);
+    pendingWarmStart.replaceAll(bytes + sizeInBytes - 8 - payloadSize, static_cast<size_t>(payloadSize));
+
+    // Loaded into a running instance: take it over now, the audio thread crossfades to the restored delays
+    if (isPrepared.load())
+        applyWarmStart();
+}
+
+void AudioPluginAudioProcessor::applyWarmStart()
+{
+    // The caller holds analysisStateLock and the estimators and trackers are prepared
+    if (pendingWarmStart.isEmpty())
+        return;
+
+    juce::MemoryInputStream input(pendingWarmStart, false);
+    const int version = input.readInt();
+    const double savedSampleRate = input.readDouble();
+    const int numTargets = input.readInt();
+    if (version != warmStartVersion || savedSampleRate <= 0.0 || ! juce::isPositiveAndNotGreaterThan(numTargets, Params::maxTargetChannels))
+    {
+        pendingWarmStart.reset();
+        return;
+    }
+
+    // Delays are in samples, so a different sample rate scales the tracks; the spectrum only fits its own rate
+    const double scale = getSampleRate() / savedSampleRate;
+    for (int t = 0; t < numTargets; ++t)
+    {
+        DelayTracker::State tracker;
+        tracker.tracking = input.readBool();
+        tracker.locked = input.readBool();
+        tracker.delay = input.readDouble() * scale;
+        tracker.drift = input.readDouble() * scale;
+        tracker.p00 = input.readDouble() * scale * scale;
+        tracker.p01 = input.readDouble() * scale * scale;
+        tracker.p11 = input.readDouble() * scale * scale;
+
+        const auto i = static_cast<size_t>(t);
+        delayTrackers[i].setState(tracker);
+        if (delayTrackers[i].hasTrack())
+        {
+            delaySamples[i].store(delayTrackers[i].getDelay());
+            newDelayAvailable[i].store(true);
+        }
+    }
+
+    numTargetsEstimated = numTargets;
+    analysisConverged.store(input.readBool());
+    if (juce::approximatelyEqual(getSampleRate(), savedSampleRate))
+        gccPhat.readAccumulator(input);
+
+    pendingWarmStart.reset();
 }
 
 //==============================================================================
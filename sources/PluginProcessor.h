@@ -1,5 +1,17 @@
 #pragma once
 
+#include "GccPhatEstimator.h"
+#include "PhaseSlopeEstimator.h"
+#include "AnalysisWorker.h"
+#include "CrossCorrelator.h"
+#include "DecimatedWindow.h"
+#include "DelayTracker.h"
+#include "DisplayBuffer.h"
+#include "FractionalDelayLine.h"
+#include "LongRangeCorrelator.h"
+#include "OnsetDetector.h"
+#include "StageProfiler.h"
+
 //==============================================================================
 namespace Params
 {
@@ -17,10 +29,48 @@ namespace Params
     constexpr float learningRateMax   = 0.5f;
     constexpr float learningRateDefault = 0.25f;
     constexpr float learningRateSensitivity = 0.01f;
+
+    // Delay estimator
+    enum class Estimator { crossCorrelation = 0, gccPhat, phaseSlope };
+    inline const juce::StringArray estimatorChoices { "Cross-Correlation", "GCC-PHAT", "Phase Slope" };
+    constexpr int estimatorDefault = static_cast<int>(Estimator::gccPhat);
+
+    // Channel mode: one delay for the mono mix, one delay per main input channel, or one delay
+    // shared by every main channel so the output keeps its stereo image
+    enum class ChannelMode { mono = 0, perChannel, stereo };
+    inline const juce::StringArray channelModeChoices { "Mono", "Per Channel", "Stereo" };
+    constexpr int channelModeDefault = static_cast<int>(ChannelMode::mono);
+    constexpr int maxTargetChannels = 8; // Widest main bus aligned against the sidechain
+
+    // Analysis trigger: the PPQ window of every beat, or a short window after every sidechain onset
+    enum class Trigger { ppqWindow = 0, onset };
+    inline const juce::StringArray triggerChoices { "PPQ Window", "Onset" };
+    constexpr int triggerDefault = static_cast<int>(Trigger::ppqWindow);
+
+    // Long-range search: delays of up to several hundred ms instead of one analysis window.
+    // It needs longer stretches of contiguous audio than a PPQ window, so it analyses every beat whole.
+    constexpr bool longRangeDefault = false;
+
+    // Low-band analysis: estimate on decimated signals, then refine at full rate
+    enum class LowBand { off = 0, x4, x8, x16 };
+    inline const juce::StringArray lowBandChoices { "Off", "x4", "x8", "x16" };
+    constexpr int lowBandDefault = static_cast<int>(LowBand::off);
+
+    // Lookahead: latency reported to the host. A target lag samples late is delayed by lookahead - lag, so once the host
+    // compensates the latency it plays lag samples earlier. 0 is zero latency and only corrects targets ahead of the reference.
+    constexpr float lookaheadMsMin = 0.0f;
+    constexpr float lookaheadMsMax = 20.0f;
+    constexpr float lookaheadMsDefault = 0.0f;
+
+    // Display
+    constexpr double displayMinBpm = 20.0; // Slowest tempo the display buffer is preallocated for
 }
 
 //==============================================================================
-class AudioPluginAudioProcessor final : public juce::AudioProcessor
+class AudioPluginAudioProcessor final : public juce::AudioProcessor,
+                                        private AnalysisWorker::Listener,
+                                        private juce::AudioProcessorValueTreeState::Listener,
+                                        private juce::AsyncUpdater
 {
 public:
     //==============================================================================
@@ -37,26 +87,80 @@ public:
     using AudioProcessor::processBlock;
 
     //==============================================================================
+    void processPiece(juce::AudioBuffer<float>& buffer);
     void processAudio(juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& sidechain, juce::AudioBuffer<float>& output);
     void clearExtraOutputChannels (juce::AudioBuffer<float>& buffer);
     void updateDisplayBufferIfNeeded(double bpm);
     int getIndexFromPpq(double ppq) const;
-    const juce::AudioBuffer<float>& getDisplayBuffer() const { return displayBuffer; }
+    juce::Optional<double> getPpqPosition(const juce::AudioPlayHead::PositionInfo& position) const;
+    const DisplayBuffer& getDisplayBuffer() const { return displayBuffer; }
+    const StageProfiler& getProfiler() const { return profiler; }
+    int getNumDroppedAnalysisBlocks() const { return analysisWorker.getNumDroppedBlocks(); }
     int getPlayheadIndex() const { return playheadIndex.load(); }
     void updateUI(juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& sidechain);
-    int findDelay(juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& sidechain);
-    void updateDelay(int delay);
-    int crossCorrelation(const float* ref, const float* target, int numSamples, int maxLagSamples, int stepSize);
+    void pushAnalysisBlock(const juce::AudioBuffer<float>& input, const juce::AudioBuffer<float>& sidechain);
+    void endAnalysisStream();
+    void triggerOnPpqWindow(const juce::AudioBuffer<float>& input, const juce::AudioBuffer<float>& sidechain);
+    void triggerOnOnsets(const juce::AudioBuffer<float>& input, const juce::AudioBuffer<float>& sidechain);
+    float findDelay(const juce::AudioBuffer<float>& window);
+    void findDelays(const juce::AudioBuffer<float>& window, int numTargets, float* delays, float* confidences);
+    void findLowBandDelays(const juce::AudioBuffer<float>& window, int numTargets, float* delays, float* confidences);
+    void estimateWindowDelays(const float* ref, const float* const* targets, int numTargets, int numSamples, float* delays, float* confidences);
+    void updateDelay(float delay, int channel = 0, bool crossfade = true);
+    void applyLookahead();
+    int computeLookaheadSamples(double sampleRate) const;
+    int getLookaheadSamples() const { return lookaheadSamples.load(); }
+    float crossCorrelation(const float* ref, const float* target, int numSamples, int maxLagSamples);
     int peakAlignment(const float* ref, const float* target, int numSamples);
-    int fftPhaseDelay(const juce::AudioBuffer<float>& buffer);
+    float fftPhaseDelay(const juce::AudioBuffer<float>& buffer);
     void stereoToMono(juce::AudioBuffer<float>& buffer);
+    void mixAnalysisTap(const juce::AudioBuffer<float>& input, const juce::AudioBuffer<float>& sidechain);
+    void tapAnalysisInput(const FractionalDelayLine& delayLine, int numChannels, int tapChannel, int numSamples);
+    int computeAnalysisOffset() const;
+    int getAnalysisOffset() const { return analysisOffsetSamples.load(); }
+    static void mixToMono(const juce::AudioBuffer<float>& source, float* destination, int numSamples);
     void copyBuffer(const juce::AudioBuffer<float>& src, int srcChannel,
                     juce::AudioBuffer<float>& dst, int dstChannel,
                     int writeStartIndex, int numSamples,
                     bool wrapAround = false);
-    int getDelaySamples() const { return delaySamples.load(); }
+    float getDelaySamples(int channel = 0) const { return delaySamples[static_cast<size_t>(channel)].load(); }
+    float getAppliedDelay(int channel = 0) const { return delayLines[static_cast<size_t>(channel)].getDelay(); } // Audio thread, lookahead included
+    float getConfidence(int channel = 0) const { return delayConfidence[static_cast<size_t>(channel)].load(); }
+    bool isConverged() const { return analysisConverged.load(); }
+    int getNumActiveTargets() const { return numActiveTargets.load(); }
+    int getNumTargets(const juce::AudioBuffer<float>& input) const;
     float getLeftPPQ() const { return leftPPQBound->load(); }
     float getRightPPQ() const { return rightPPQBound->load(); }
+    Params::Estimator getEstimator() const
+    {
+        if (estimatorType != nullptr)
+            return static_cast<Params::Estimator>(static_cast<int>(estimatorType->load()));
+        return static_cast<Params::Estimator>(Params::estimatorDefault);
+    }
+    Params::Trigger getTrigger() const
+    {
+        if (triggerType != nullptr)
+            return static_cast<Params::Trigger>(static_cast<int>(triggerType->load()));
+        return static_cast<Params::Trigger>(Params::triggerDefault);
+    }
+    Params::LowBand getLowBand() const
+    {
+        if (lowBandType != nullptr)
+            return static_cast<Params::LowBand>(static_cast<int>(lowBandType->load()));
+        return static_cast<Params::LowBand>(Params::lowBandDefault);
+    }
+    bool isLongRangeSearch() const
+    {
+        if (longRangeFlag != nullptr)
+            return longRangeFlag->load() >= 0.5f;
+        return Params::longRangeDefault;
+    }
+    Params::ChannelMode getChannelMode() const
+    {
+        if (channelModeType != nullptr)
+            return static_cast<Params::ChannelMode>(static_cast<int>(channelModeType->load()));
+        return static_cast<Params::ChannelMode>(Params::channelModeDefault);
+    }
     juce::AudioProcessorValueTreeState& getValueTreeState() { return parameters; }
     juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
     float getLearningRate() const
@@ -96,18 +200,90 @@ public:
 
 private:
     //==============================================================================
-    juce::AudioBuffer<float> displayBuffer;
+    void analysisSamplesReceived(const float* ref, const float* const* targets, int numTargets, int numSamples) override;
+    void analysisWindowUpdated(const juce::AudioBuffer<float>& window, int numTargets) override;
+    void analysisReset() override;
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
+    void handleAsyncUpdate() override;
+    juce::int64 getMeasurementIndex(int windowSize) const;
+    void fuseEstimates(int numTargets, juce::int64 measurement);
+    void writeWarmStart(juce::MemoryBlock& destData);
+    void readWarmStart(const void* data, int sizeInBytes);
+    void applyWarmStart();
+
+    //==============================================================================
+    DisplayBuffer displayBuffer;
+    static constexpr int numDisplaySources = 2;     // The input and the sidechain, whatever the bus layout
+    StageProfiler profiler;
     double displayBufferBpm = -1.0;
     std::atomic<int> playheadIndex { 0 };
-    juce::AudioBuffer<float> analysisBuffer;
-    int analysisBufferWritePos = 0;
-    int crossCorrelationStepSize = 4;
-    std::atomic<int> delaySamples { 0 };
+    int crossCorrelationDecimation = 4;
+    CrossCorrelator crossCorrelator;
+    GccPhatEstimator gccPhat;
+    float crossSpectrumSmoothing = 0.2f;
+    PhaseSlopeEstimator phaseSlope;
+    LongRangeCorrelator longRange;
+    float longRangeMaxDelayMs = 500.0f;     // Search range of the long-range mode
+    double longRangeAnalysisRate = 6000.0;  // Rate its coarse search is decimated to, in Hz
+    int longRangePartitionSize = 512;       // Decimated samples per FFT partition
+    std::array<DecimatedWindow, 3> lowBandWindows;  // x4, x8 and x16, all prepared so switching never allocates
+    DecimatedWindow* activeLowBandWindow = nullptr; // Analysis thread: the one being fed, if any
+    std::array<const float*, Params::maxTargetChannels> lowBandTargets {}; // Analysis thread scratch
+    std::array<std::atomic<float>, Params::maxTargetChannels> delaySamples {};
+    std::array<std::atomic<bool>, Params::maxTargetChannels> newDelayAvailable {};
+    std::array<float, Params::maxTargetChannels> analysisDelays {}; // Analysis thread scratch
+    std::array<int, Params::maxTargetChannels> analysisLags {};     // Analysis thread scratch
+    std::array<float, Params::maxTargetChannels> analysisConfidences {};    // Analysis thread scratch
+    std::array<std::atomic<float>, Params::maxTargetChannels> delayConfidence {}; // Peak-to-sidelobe ratio in dB of the latest estimate
+    std::array<DelayTracker, Params::maxTargetChannels> delayTrackers;     // Analysis thread: fuses each target's estimates
+    juce::int64 samplesSinceEstimate = 0;   // Analysis thread
+    juce::int64 samplesAnalysed = 0;        // Analysis thread: since prepareToPlay(), counts the window hops
+    juce::int64 lastMeasurement = -1;       // Analysis thread: getMeasurementIndex() of the last estimate
+    int accumulatedOffset = -1;             // Analysis thread: analysis offset the running spectra were built behind
+    int numTargetsEstimated = 1;            // Analysis thread
+    std::atomic<bool> analysisConverged { false };
+    float silenceThresholdDb = -60.0f;      // Blocks quieter than this on the sidechain or every target are not analysed
+    float minConfidenceDb = 3.0f;           // Estimates with a flatter correlation peak are not applied
+    double convergenceSeconds = 2.0;        // Analysed audio every track must run for before it can lock
+    int convergedBeatInterval = 4;          // Once converged, only every n-th beat (or onset) is analysed
+    OnsetDetector onsetDetector;
+    int onsetWindowSamples = 0;             // Analysed after each onset: one analysis window
+    int longRangeOnsetWindowSamples = 0;    // Same in long-range mode: enough history for an estimate
+    int onsetSamplesRemaining = 0;          // Audio thread: left in the current onset window
+    juce::int64 numOnsets = 0;              // Audio thread
+    bool analysisStreamOpen = false;        // Audio thread: blocks were pushed since the last reset
+    std::atomic<int> numActiveTargets { 1 };
+    int numTargetsPushed = 1;
     float delayToleranceMs = 0.1f;
-    juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::Lagrange3rd> delayLine;
+    float delayCrossfadeMs = 10.0f;
+    std::array<FractionalDelayLine, Params::maxTargetChannels> delayLines;
+    Params::ChannelMode processedChannelMode = Params::ChannelMode::mono;  // Audio thread: the mode the delay line histories belong to
+    std::atomic<int> lookaheadSamples { 0 };  // Audio thread: fixed part of every delay line
+    std::atomic<int> reportedLookaheadSamples { 0 };  // Latency the message thread last reported; the audio thread follows it
+    std::atomic<int> analysisOffsetSamples { 0 };     // Audio thread: how far behind the block the analysis reads the input
+    int maxWindowDelaySamples = 0;                    // Longest correction outside long-range mode
+    int preparedBlockSize = 1;                  // Block size announced to prepareToPlay(); longer blocks are split
+    int blockOffset = 0;                        // Audio thread: where the piece being processed starts in the host's block
+    juce::AudioBuffer<float> analysisTap;       // The uncorrected input behind the analysis offset, one channel per target
+    juce::AudioBuffer<float> monoTap;           // Stereo mode: mono mixes of the corrected input and the sidechain, never output
+    juce::AudioBuffer<float> analysisInput;     // Audio thread: what the analysis sees, a view of analysisTap
+    juce::AudioBuffer<float> displayInput;      // Audio thread: what the display sees, a view of the input bus or of monoTap
+    juce::AudioBuffer<float> analysisSidechain; // Audio thread: the reference for both, a view of the sidechain bus or of monoTap
     float audioPluginCutOffFrequency = 30.0f;
     juce::AudioProcessorValueTreeState parameters;
     std::atomic<float>* leftPPQBound = nullptr;
     std::atomic<float>* rightPPQBound = nullptr;
+    std::atomic<float>* estimatorType = nullptr;
+    std::atomic<float>* channelModeType = nullptr;
+    std::atomic<float>* triggerType = nullptr;
+    std::atomic<float>* longRangeFlag = nullptr;
+    std::atomic<float>* lowBandType = nullptr;
+    std::atomic<float>* lookaheadMs = nullptr;
+    juce::CriticalSection analysisStateLock;    // Held by the analysis thread while it changes the estimators and trackers
+    juce::MemoryBlock pendingWarmStart;         // Restored learned state, applied once prepared; guarded by analysisStateLock
+    std::atomic<bool> isPrepared { false };
+    static constexpr int warmStartMagic = 0x73775069;   // "iPws", the footer that marks the learned state after the XML
+    static constexpr int warmStartVersion = 1;
+    AnalysisWorker analysisWorker { *this }; // Declared last: the pool threads servicing it use the members above
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioPluginAudioProcessor)
 };
@@ -0,0 +1,72 @@
+#include <JuceHeader.h>
+#include "CorrelationKernels.h"
+#include "PolyphaseDecimator.h"
+
+//==============================================================================
+void PolyphaseDecimator::prepare(int newFactor, int maxNumChannels, int tapsPerPhase)
+{
+    factor = juce::jmax(1, newFactor);
+    numTaps = juce::jmax(1, tapsPerPhase) * factor + 1; // Odd, so the group delay is a whole sample
+
+    // Hann-windowed sinc, normalised to unity gain at DC
+    taps.allocate(static_cast<size_t>(numTaps), true);
+    const double cutoff = 0.8 * 0.5 / factor;
+    const int centre = numTaps / 2;
+    double sum = 0.0;
+    for (int i = 0; i < numTaps; ++i)
+    {
+        const double x = static_cast<double>(i - centre);
+        const double sinc = i == centre ? 2.0 * cutoff : std::sin(juce::MathConstants<double>::twoPi * cutoff * x) / (juce::MathConstants<double>::pi * x);
+        const double window = 0.5 - 0.5 * std::cos(juce::MathConstants<double>::twoPi * (i + 1) / (numTaps + 1));
+        taps[numTaps - 1 - i] = static_cast<float>(sinc * window);
+        sum += sinc * window;
+    }
+    juce::FloatVectorOperations::multiply(taps, static_cast<float>(1.0 / sum), numTaps);
+
+    // A pass writes up to samplesPerPass inputs; the first output of the pass still needs numTaps - 1 older ones
+    history.clear();
+    for (int channel = 0; channel < juce::jmax(1, maxNumChannels); ++channel)
+    {
+        history.push_back(std::make_unique<MirroredRingBuffer>());
+        history.back()->allocate(numTaps + 64 * factor);
+    }
+    samplesPerPass = history.front()->getCapacity() - numTaps;
+
+    reset();
+}
+
+void PolyphaseDecimator::reset()
+{
+    for (auto& ring : history)
+        ring->clear();
+
+    phase = 0;
+}
+
+//==============================================================================
+int PolyphaseDecimator::process(const float* const* inputs, float* const* outputs, int numChannels, int numSamples)
+{
+    numChannels = juce::jmin(numChannels, static_cast<int>(history.size()));
+    int numOutputs = 0;
+
+    for (int offset = 0; offset < numSamples; offset += samplesPerPass)
+    {
+        const int numToWrite = juce::jmin(samplesPerPass, numSamples - offset);
+        for (int channel = 0; channel < numChannels; ++channel)
+            history[static_cast<size_t>(channel)]->write(inputs[channel] + offset, numToWrite);
+
+        // Input i of the pass completes an output when the phase comes round; its taps end at i
+        for (int i = factor - 1 - phase; i < numToWrite; i += factor)
+        {
+            const int samplesAfter = numToWrite - 1 - i;
+            for (int channel = 0; channel < numChannels; ++channel)
+                outputs[channel][numOutputs] = CorrelationKernels::dotProduct(history[static_cast<size_t>(channel)]->getNewest(numTaps + samplesAfter), taps, numTaps);
+
+            ++numOutputs;
+        }
+
+        phase = (phase + numToWrite) % factor;
+    }
+
+    return numOutputs;
+}
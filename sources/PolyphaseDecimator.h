@@ -0,0 +1,38 @@
+#pragma once
+
+#include "MirroredRingBuffer.h"
+
+//==============================================================================
+// Streaming anti-aliased decimation by an integer factor, for analysis paths.
+// The low-pass is a Hann-windowed sinc at 80 % of the decimated Nyquist, with
+// tapsPerPhase taps per polyphase branch. Only every factor-th output is computed,
+// as a polyphase decimator would, so the cost is tapsPerPhase multiply-adds per input
+// sample and channel. Channels share one phase, and the filter's group delay is the
+// same on all of them, so lags measured between them are unaffected.
+// Each channel's input history is a MirroredRingBuffer. A run of input is written in
+// one go, and every output reads its taps straight out of the ring.
+class PolyphaseDecimator
+{
+public:
+    //==============================================================================
+    PolyphaseDecimator() = default;
+
+    void prepare(int factor, int maxNumChannels, int tapsPerPhase = 8);
+    void reset();
+
+    // Returns the number of outputs written per channel: at most numSamples / factor + 1
+    int process(const float* const* inputs, float* const* outputs, int numChannels, int numSamples);
+
+    int getFactor() const { return factor; }
+    int getNumTaps() const { return numTaps; }
+
+private:
+    //==============================================================================
+    std::vector<std::unique_ptr<MirroredRingBuffer>> history;   // One per channel
+    juce::HeapBlock<float> taps;            // Time-reversed, to line up with the history
+    int factor = 1;
+    int numTaps = 1;
+    int samplesPerPass = 1;                 // Input written before the outputs it completes are computed
+    int phase = 0;
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PolyphaseDecimator)
+};
@@ -0,0 +1,176 @@
+#include <JuceHeader.h>
+#include "StageProfiler.h"
+
+//==============================================================================
+StageProfiler::StageProfiler()
+{
+    nanosecondsPerTick = 1.0e9 / static_cast<double>(juce::Time::getHighResolutionTicksPerSecond());
+}
+
+void StageProfiler::reset()
+{
+    for (auto& histogram : histograms)
+    {
+        for (auto& bin : histogram.bins)
+            bin.store(0, std::memory_order_relaxed);
+
+        histogram.count.store(0, std::memory_order_relaxed);
+        histogram.overruns.store(0, std::memory_order_relaxed);
+        histogram.totalNanoseconds.store(0, std::memory_order_relaxed);
+        histogram.maxNanoseconds.store(0, std::memory_order_relaxed);
+    }
+}
+
+//==============================================================================
+int StageProfiler::getBinIndex(juce::uint64 nanoseconds)
+{
+    if (nanoseconds < (juce::uint64(1) << firstOctave))
+        return 0;
+
+    // Octave from the highest set bit, quarter octave from the two bits below it
+    int octave = 0;
+    while ((nanoseconds >> (octave + 1)) != 0)
+        ++octave;
+
+    const int quarter = static_cast<int>((nanoseconds >> (octave - 2)) & 3);
+    return juce::jmin(numBins - 1, (octave - firstOctave) * binsPerOctave + quarter);
+}
+
+double StageProfiler::getBinUpperMicroseconds(int bin)
+{
+    // Bin b covers [(4 + quarter) << (octave - 2), its successor's lower edge)
+    const int next = bin + 1;
+    const int octave = firstOctave + next / binsPerOctave;
+    const int quarter = next % binsPerOctave;
+    return std::ldexp(static_cast<double>(binsPerOctave + quarter), octave - 2) / 1000.0;
+}
+
+void StageProfiler::record(Stage stage, juce::int64 startTicks, juce::int64 endTicks, double budgetSeconds)
+{
+    auto& histogram = histograms[static_cast<size_t>(stage)];
+    const auto nanoseconds = static_cast<juce::uint64>(juce::jmax(0.0, static_cast<double>(endTicks - startTicks) * nanosecondsPerTick));
+
+    // Single writer per stage: plain load + store, no read-modify-write needed
+    auto& bin = histogram.bins[static_cast<size_t>(getBinIndex(nanoseconds))];
+    bin.store(bin.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    histogram.totalNanoseconds.store(histogram.totalNanoseconds.load(std::memory_order_relaxed) + nanoseconds, std::memory_order_relaxed);
+
+    if (nanoseconds > histogram.maxNanoseconds.load(std::memory_order_relaxed))
+        histogram.maxNanoseconds.store(nanoseconds, std::memory_order_relaxed);
+
+    if (static_cast<double>(nanoseconds) > budgetSeconds * 1.0e9)
+        histogram.overruns.store(histogram.overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    histogram.count.store(histogram.count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+//==============================================================================
+double StageProfiler::getPercentile(const Histogram& histogram, juce::uint64 count, double fraction) const
+{
+    if (count == 0)
+        return 0.0;
+
+    const auto rank = juce::jmax(juce::uint64(1), static_cast<juce::uint64>(std::ceil(fraction * static_cast<double>(count))));
+    const double maxMicroseconds = static_cast<double>(histogram.maxNanoseconds.load(std::memory_order_relaxed)) / 1000.0;
+
+    juce::uint64 cumulative = 0;
+    for (int bin = 0; bin < numBins; ++bin)
+    {
+        cumulative += histogram.bins[static_cast<size_t>(bin)].load(std::memory_order_relaxed);
+        if (cumulative >= rank)
+            return juce::jmin(getBinUpperMicroseconds(bin), maxMicroseconds);
+    }
+
+    return maxMicroseconds;
+}
+
+StageProfiler::Stats StageProfiler::getStats(Stage stage) const
+{
+    const auto& histogram = histograms[static_cast<size_t>(stage)];
+
+    Stats stats;
+    stats.count = histogram.count.load(std::memory_order_relaxed);
+    stats.overruns = histogram.overruns.load(std::memory_order_relaxed);
+    stats.maxMicroseconds = static_cast<double>(histogram.maxNanoseconds.load(std::memory_order_relaxed)) / 1000.0;
+    if (stats.count > 0)
+        stats.meanMicroseconds = static_cast<double>(histogram.totalNanoseconds.load(std::memory_order_relaxed)) / 1000.0 / static_cast<double>(stats.count);
+
+    stats.p50Microseconds = getPercentile(histogram, stats.count, 0.50);
+    stats.p90Microseconds = getPercentile(histogram, stats.count, 0.90);
+    stats.p99Microseconds = getPercentile(histogram, stats.count, 0.99);
+    return stats;
+}
+
+juce::String StageProfiler::getStageName(Stage stage)
+{
+    switch (stage)
+    {
+        case Stage::processAudio: return "processAudio";
+        case Stage::updateUI:     return "updateUI";
+        case Stage::findDelay:    return "findDelay";
+        default:                  return {};
+    }
+}
+
+//==============================================================================
+juce::String StageProfiler::toCsv() const
+{
+    juce::String csv("stage,count,overruns,meanUs,p50Us,p90Us,p99Us,maxUs\n");
+
+    for (int s = 0; s < numStages; ++s)
+    {
+        const auto stage = static_cast<Stage>(s);
+        const auto stats = getStats(stage);
+        csv << getStageName(stage) << ","
+            << juce::String(static_cast<juce::int64>(stats.count)) << ","
+            << juce::String(static_cast<juce::int64>(stats.overruns)) << ","
+            << juce::String(stats.meanMicroseconds, 3) << ","
+            << juce::String(stats.p50Microseconds, 3) << ","
+            << juce::String(stats.p90Microseconds, 3) << ","
+            << juce::String(stats.p99Microseconds, 3) << ","
+            << juce::String(stats.maxMicroseconds, 3) << "\n";
+    }
+
+    return csv;
+}
+
+juce::String StageProfiler::toJson() const
+{
+    juce::Array<juce::var> stages;
+
+    for (int s = 0; s < numStages; ++s)
+    {
+        const auto stage = static_cast<Stage>(s);
+        const auto stats = getStats(stage);
+        const auto& histogram = histograms[static_cast<size_t>(s)];
+
+        juce::Array<juce::var> bins;
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            const auto count = histogram.bins[static_cast<size_t>(bin)].load(std::memory_order_relaxed);
+            if (count == 0)
+                continue;
+
+            auto* entry = new juce::DynamicObject();
+            entry->setProperty("upperUs", getBinUpperMicroseconds(bin));
+            entry->setProperty("count", static_cast<juce::int64>(count));
+            bins.add(juce::var(entry));
+        }
+
+        auto* object = new juce::DynamicObject();
+        object->setProperty("stage", getStageName(stage));
+        object->setProperty("count", static_cast<juce::int64>(stats.count));
+        object->setProperty("overruns", static_cast<juce::int64>(stats.overruns));
+        object->setProperty("meanUs", stats.meanMicroseconds);
+        object->setProperty("p50Us", stats.p50Microseconds);
+        object->setProperty("p90Us", stats.p90Microseconds);
+        object->setProperty("p99Us", stats.p99Microseconds);
+        object->setProperty("maxUs", stats.maxMicroseconds);
+        object->setProperty("bins", bins);
+        stages.add(juce::var(object));
+    }
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty("stages", stages);
+    return juce::JSON::toString(juce::var(root));
+}
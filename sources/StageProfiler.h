@@ -0,0 +1,89 @@
+#pragma once
+
+//==============================================================================
+// Per-stage timing histograms for the hot paths: processAudio and updateUI on the
+// audio thread, findDelay on the analysis thread.
+// Every stage has exactly one writer thread, so record() is a handful of relaxed
+// atomic stores: no locks, no allocation. Any thread can read the statistics at
+// any time; a read racing a write may be one sample behind, which is fine here.
+//
+// Durations go into log-spaced bins, four per octave from 64 ns to about one
+// second, so percentiles are accurate to roughly 19%. A duration longer than the
+// budget passed to record() (the block length for audio-thread stages) also
+// counts as an overrun.
+class StageProfiler
+{
+public:
+    //==============================================================================
+    enum class Stage { processAudio = 0, updateUI, findDelay };
+    static constexpr int numStages = 3;
+    static constexpr int numBins = 96;
+
+    StageProfiler();
+
+    // While no stage is running, e.g. in prepareToPlay
+    void reset();
+
+    //==============================================================================
+    // The stage's own thread
+    void record(Stage stage, juce::int64 startTicks, juce::int64 endTicks, double budgetSeconds);
+
+    class ScopedTimer
+    {
+    public:
+        ScopedTimer(StageProfiler& profilerToUse, Stage stageToTime, double budgetSecondsToUse)
+            : profiler(profilerToUse), stage(stageToTime), budgetSeconds(budgetSecondsToUse),
+              startTicks(juce::Time::getHighResolutionTicks()) {}
+
+        ~ScopedTimer() { profiler.record(stage, startTicks, juce::Time::getHighResolutionTicks(), budgetSeconds); }
+
+    private:
+        StageProfiler& profiler;
+        Stage stage;
+        double budgetSeconds;
+        juce::int64 startTicks;
+        JUCE_DECLARE_NON_COPYABLE (ScopedTimer)
+    };
+
+    //==============================================================================
+    // Any thread
+    struct Stats
+    {
+        juce::uint64 count = 0;
+        juce::uint64 overruns = 0;
+        double meanMicroseconds = 0.0;
+        double p50Microseconds = 0.0;
+        double p90Microseconds = 0.0;
+        double p99Microseconds = 0.0;
+        double maxMicroseconds = 0.0;
+    };
+
+    Stats getStats(Stage stage) const;
+    static juce::String getStageName(Stage stage);
+
+    // One summary row per stage
+    juce::String toCsv() const;
+    // Summaries plus the non-empty histogram bins of every stage
+    juce::String toJson() const;
+
+private:
+    //==============================================================================
+    struct Histogram
+    {
+        std::array<std::atomic<juce::uint32>, numBins> bins {};
+        std::atomic<juce::uint64> count { 0 };
+        std::atomic<juce::uint64> overruns { 0 };
+        std::atomic<juce::uint64> totalNanoseconds { 0 };
+        std::atomic<juce::uint64> maxNanoseconds { 0 };
+    };
+
+    static int getBinIndex(juce::uint64 nanoseconds);
+    static double getBinUpperMicroseconds(int bin);
+    double getPercentile(const Histogram& histogram, juce::uint64 count, double fraction) const;
+
+    std::array<Histogram, numStages> histograms;
+    double nanosecondsPerTick = 1.0;
+    static constexpr int firstOctave = 6;   // Bin 0 ends at 2^6 ns, everything shorter lands there too
+    static constexpr int binsPerOctave = 4;
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StageProfiler)
+};
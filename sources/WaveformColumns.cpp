@@ -0,0 +1,94 @@
+#include <JuceHeader.h>
+#include "WaveformColumns.h"
+
+//==============================================================================
+// Column c spans samples [c * length / numColumns, (c + 1) * length / numColumns), and at least one sample.
+// These bound the columns that contain a sample from below and above.
+int WaveformColumns::firstColumnForSample(int sampleIndex) const
+{
+    return static_cast<int>(static_cast<juce::int64>(sampleIndex) * numColumns / juce::jmax(1, seen.length));
+}
+
+int WaveformColumns::lastColumnForSample(int sampleIndex) const
+{
+    const juce::int64 length = juce::jmax(1, seen.length);
+    const auto column = ((static_cast<juce::int64>(sampleIndex) + 1) * numColumns + length - 1) / length - 1;
+    return juce::jlimit(0, numColumns - 1, static_cast<int>(column));
+}
+
+bool WaveformColumns::readRange(const DisplayBuffer& display, int firstColumn, int numColumnsToRead)
+{
+    DisplayBuffer::FrameState state;
+    if (! display.readColumns(numColumns, firstColumn, numColumnsToRead,
+                              mins.getArrayOfWritePointers(), maxs.getArrayOfWritePointers(), state))
+        return false;
+
+    // A tempo change between reading the state and the columns leaves the columns mismatched
+    return state.generation == seen.generation && state.length == seen.length;
+}
+
+bool WaveformColumns::update(const DisplayBuffer& display, int newNumColumns)
+{
+    dirtyRanges[0] = dirtyRanges[1] = {};
+    if (newNumColumns <= 0 || display.getNumChannels() == 0)
+        return false;
+
+    if (newNumColumns != numColumns || display.getNumChannels() != mins.getNumChannels())
+    {
+        numColumns = newNumColumns;
+        mins.setSize(display.getNumChannels(), numColumns);
+        maxs.setSize(display.getNumChannels(), numColumns);
+        mins.clear();
+        maxs.clear();
+        needsFullRefresh = true;
+    }
+
+    DisplayBuffer::FrameState now;
+    if (! display.readFrameState(now) || now.length <= 0)
+        return false;
+
+    const auto previous = seen;
+    const bool layoutChanged = now.generation != previous.generation || now.length != previous.length;
+    const juce::int64 numWritten = now.totalWritten - previous.totalWritten;
+    const int forwardDistance = (now.writeEndIndex - previous.writeEndIndex + now.length) % now.length;
+    seen = now;
+
+    // The dirty span runs forward from where the last frame ended; anything more than that means a jump or a lap
+    if (needsFullRefresh || layoutChanged || numWritten > forwardDistance)
+    {
+        needsFullRefresh = ! readRange(display, 0, numColumns);
+        dirtyRanges[0] = { 0, numColumns };
+        return true;
+    }
+
+    if (numWritten == 0)
+        return false;
+
+    const int firstColumn = firstColumnForSample(previous.writeEndIndex);
+    const int lastColumn = lastColumnForSample((now.writeEndIndex - 1 + now.length) % now.length);
+
+    const bool wraps = previous.writeEndIndex + forwardDistance > now.length;
+
+    bool ok;
+    if (! wraps)
+    {
+        dirtyRanges[0] = { firstColumn, lastColumn + 1 };
+        ok = readRange(display, firstColumn, lastColumn + 1 - firstColumn);
+    }
+    else if (firstColumn > lastColumn)
+    {
+        dirtyRanges[0] = { firstColumn, numColumns };
+        dirtyRanges[1] = { 0, lastColumn + 1 };
+        ok = readRange(display, firstColumn, numColumns - firstColumn)
+             && readRange(display, 0, lastColumn + 1);
+    }
+    else
+    {
+        // Wrapped back into the starting column: every column is dirty
+        dirtyRanges[0] = { 0, numColumns };
+        ok = readRange(display, 0, numColumns);
+    }
+
+    needsFullRefresh = ! ok;
+    return true;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "DisplayBuffer.h"
+
+//==============================================================================
+// Editor-side min/max per pixel column. update() re-reads only the columns covering
+// samples written since the previous frame. It falls back to a full refresh when the
+// width or the beat length changed, when the writer lapped the reader, or after a
+// torn read.
+class WaveformColumns
+{
+public:
+    //==============================================================================
+    WaveformColumns() = default;
+
+    // Message thread. Returns true if any column changed.
+    bool update(const DisplayBuffer& display, int numColumns);
+    void invalidate() { needsFullRefresh = true; }
+
+    int getNumColumns() const { return numColumns; }
+    int getNumChannels() const { return mins.getNumChannels(); }
+    const float* getMins(int channel) const { return mins.getReadPointer(channel); }
+    const float* getMaxs(int channel) const { return maxs.getReadPointer(channel); }
+    int getPlayheadIndex() const { return seen.playheadIndex; }
+    int getLength() const { return seen.length; }
+
+    // Columns refreshed by the last update(), as [start, end) ranges; the second range is empty unless the update wrapped
+    juce::Range<int> getDirtyRange(int index) const { return dirtyRanges[index & 1]; }
+
+private:
+    //==============================================================================
+    bool readRange(const DisplayBuffer& display, int firstColumn, int numColumnsToRead);
+    int firstColumnForSample(int sampleIndex) const;
+    int lastColumnForSample(int sampleIndex) const;
+
+    juce::AudioBuffer<float> mins;
+    juce::AudioBuffer<float> maxs;
+    DisplayBuffer::FrameState seen;
+    juce::Range<int> dirtyRanges[2];
+    int numColumns = 0;
+    bool needsFullRefresh = true;
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WaveformColumns)
+};
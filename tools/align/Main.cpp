@@ -0,0 +1,208 @@
+#include <JuceHeader.h>
+#include <iostream>
+#include "StemAligner.h"
+
+//==============================================================================
+namespace
+{
+    struct Job
+    {
+        juce::File reference;
+        juce::File target;
+    };
+
+    void printUsage()
+    {
+        std::cout << "Usage:\n"
+                     "  inPhaseAlign [options] --reference <file> <target> [<target> ...]\n"
+                     "  inPhaseAlign [options] --sessions <list>\n"
+                     "\n"
+                     "Each line of a session list is a reference followed by its targets, separated by tabs.\n"
+                     "\n"
+                     "Options:\n"
+                     "  -e, --estimator <gcc|xcorr|phase>  Delay estimator (default gcc)\n"
+                     "  -m, --max-delay-ms <ms>            Largest lag searched (default 33.3)\n"
+                     "  -b, --bpm <bpm>                    Report one lag per beat at this tempo\n"
+                     "      --first-beat <seconds>         Position of a downbeat (default 0)\n"
+                     "      --left-ppq <0..1>              Start of the analysed part of each beat (default 0.2)\n"
+                     "      --right-ppq <0..1>             End of the analysed part of each beat (default 0.8)\n"
+                     "  -o, --output-dir <dir>             Write each target advanced by its lag\n"
+                     "  -j, --jobs <n>                     Files processed in parallel (default: all cores)\n"
+                     "      --block <n>                    Streaming block size (default 4096)\n";
+    }
+
+    bool parseEstimator(const juce::String& name, StemAligner::Estimator& estimator)
+    {
+        if (name == "gcc")   { estimator = StemAligner::Estimator::gccPhat;          return true; }
+        if (name == "xcorr") { estimator = StemAligner::Estimator::crossCorrelation; return true; }
+        if (name == "phase") { estimator = StemAligner::Estimator::phaseSlope;       return true; }
+        return false;
+    }
+
+    bool readSessions(const juce::File& list, std::vector<Job>& jobs)
+    {
+        juce::StringArray lines;
+        list.readLines(lines);
+
+        for (auto& line : lines)
+        {
+            auto fields = juce::StringArray::fromTokens(line, "\t", "\"");
+            fields.trim();
+            fields.removeEmptyStrings();
+            if (fields.size() < 2)
+                continue;
+
+            const auto reference = list.getParentDirectory().getChildFile(fields[0]);
+            for (int i = 1; i < fields.size(); ++i)
+                jobs.push_back({ reference, list.getParentDirectory().getChildFile(fields[i]) });
+        }
+
+        return ! jobs.empty();
+    }
+
+    void printResult(const StemAligner::Result& result)
+    {
+        if (result.error.isNotEmpty())
+        {
+            std::cout << result.target.getFullPathName() << "\terror\t" << result.error << "\n";
+            return;
+        }
+
+        const double ms = 1000.0 * result.lagSamples / result.sampleRate;
+        std::cout << result.target.getFullPathName() << "\t" << juce::String(result.lagSamples, 2)
+                  << " samples\t" << juce::String(ms, 3) << " ms\t" << result.numWindows << " windows";
+        if (result.output != juce::File())
+            std::cout << "\t-> " << result.output.getFullPathName();
+        std::cout << "\n";
+
+        for (const auto& beat : result.beatLags)
+            std::cout << "\tbeat " << beat.beatIndex << "\t" << juce::String(beat.lagSamples, 2) << " samples\n";
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    StemAligner::Settings settings;
+    std::vector<Job> jobs;
+    juce::File reference;
+    juce::StringArray targets;
+    int numThreads = juce::SystemStats::getNumCpus();
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const juce::String arg(argv[i]);
+        const auto next = [&]() -> juce::String
+        {
+            if (i + 1 < argc)
+                return juce::String(argv[++i]);
+
+            std::cerr << "missing value for " << arg << "\n";
+            std::exit(1);
+        };
+
+        if (arg == "-h" || arg == "--help")                 { printUsage(); return 0; }
+        else if (arg == "-r" || arg == "--reference")       reference = juce::File::getCurrentWorkingDirectory().getChildFile(next());
+        else if (arg == "--sessions")
+        {
+            const auto list = juce::File::getCurrentWorkingDirectory().getChildFile(next());
+            if (! readSessions(list, jobs))
+            {
+                std::cerr << "no sessions in " << list.getFullPathName() << "\n";
+                return 1;
+            }
+        }
+        else if (arg == "-e" || arg == "--estimator")
+        {
+            if (! parseEstimator(next(), settings.estimator))
+            {
+                std::cerr << "unknown estimator\n";
+                return 1;
+            }
+        }
+        else if (arg == "-m" || arg == "--max-delay-ms")    settings.maxDelayMs = next().getDoubleValue();
+        else if (arg == "-b" || arg == "--bpm")             settings.bpm = next().getDoubleValue();
+        else if (arg == "--first-beat")                     settings.firstBeatSeconds = next().getDoubleValue();
+        else if (arg == "--left-ppq")                       settings.leftPPQ = next().getDoubleValue();
+        else if (arg == "--right-ppq")                      settings.rightPPQ = next().getDoubleValue();
+        else if (arg == "-o" || arg == "--output-dir")      settings.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(next());
+        else if (arg == "-j" || arg == "--jobs")            numThreads = next().getIntValue();
+        else if (arg == "--block")                          settings.blockSize = next().getIntValue();
+        else if (arg.startsWith("-"))
+        {
+            std::cerr << "unknown option " << arg << "\n";
+            printUsage();
+            return 1;
+        }
+        else
+        {
+            targets.add(arg);
+        }
+    }
+
+    for (auto& target : targets)
+    {
+        if (reference == juce::File())
+        {
+            std::cerr << "targets given without --reference\n";
+            return 1;
+        }
+        jobs.push_back({ reference, juce::File::getCurrentWorkingDirectory().getChildFile(target) });
+    }
+
+    if (jobs.empty())
+    {
+        printUsage();
+        return 1;
+    }
+
+    if (settings.outputDirectory != juce::File() && settings.outputDirectory.createDirectory().failed())
+    {
+        std::cerr << "cannot create " << settings.outputDirectory.getFullPathName() << "\n";
+        return 1;
+    }
+
+    // Every job writes its own file, and none may land on a file another job reads
+    if (settings.outputDirectory != juce::File())
+    {
+        for (size_t i = 0; i < jobs.size(); ++i)
+        {
+            const auto output = StemAligner::getOutputFile(jobs[i].target, settings);
+            for (size_t j = 0; j < jobs.size(); ++j)
+            {
+                if (StemAligner::isSameFile(output, jobs[j].reference) || StemAligner::isSameFile(output, jobs[j].target))
+                {
+                    std::cerr << "refusing to overwrite an input: " << output.getFullPathName() << "\n";
+                    return 1;
+                }
+
+                if (j < i && StemAligner::isSameFile(output, StemAligner::getOutputFile(jobs[j].target, settings)))
+                {
+                    std::cerr << "more than one target would be written to " << output.getFullPathName() << "\n";
+                    return 1;
+                }
+            }
+        }
+    }
+
+    // One file per job; each job streams its own readers, so memory stays flat however many files there are
+    std::vector<StemAligner::Result> results(jobs.size());
+    {
+        juce::ThreadPool pool(juce::jlimit(1, juce::jmax(1, static_cast<int>(jobs.size())), numThreads));
+        for (size_t i = 0; i < jobs.size(); ++i)
+            pool.addJob([&jobs, &results, &settings, i] { results[i] = StemAligner::align(jobs[i].reference, jobs[i].target, settings); });
+
+        while (pool.getNumJobs() > 0)
+            juce::Thread::sleep(20);
+    }
+
+    // Report in input order, not completion order
+    int numFailed = 0;
+    for (const auto& result : results)
+    {
+        printResult(result);
+        numFailed += result.error.isNotEmpty() ? 1 : 0;
+    }
+
+    return numFailed == 0 ? 0 : 2;
+}
@@ -0,0 +1,368 @@
+#include <JuceHeader.h>
+#include "FractionalDelayLine.h"
+#include "StemAligner.h"
+
+namespace StemAligner
+{
+//==============================================================================
+namespace
+{
+    // Streams a file as a mono mix, one block at a time
+    class MonoStream
+    {
+    public:
+        MonoStream(juce::AudioFormatReader& readerToUse, int blockSize)
+            : reader(readerToUse), readBuffer(static_cast<int>(readerToUse.numChannels), blockSize), mono(1, blockSize)
+        {
+        }
+
+        const float* read(juce::int64 start, int numSamples)
+        {
+            reader.read(&readBuffer, 0, numSamples, start, true, true);
+
+            mono.copyFrom(0, 0, readBuffer, 0, 0, numSamples);
+            for (int ch = 1; ch < readBuffer.getNumChannels(); ++ch)
+                mono.addFrom(0, 0, readBuffer, ch, 0, numSamples);
+            mono.applyGain(0, 0, numSamples, 1.0f / static_cast<float>(readBuffer.getNumChannels()));
+
+            return mono.getReadPointer(0);
+        }
+
+    private:
+        juce::AudioFormatReader& reader;
+        juce::AudioBuffer<float> readBuffer;
+        juce::AudioBuffer<float> mono;
+    };
+
+    // Window-level estimators, sized once like the processor's
+    class WindowEstimator
+    {
+    public:
+        WindowEstimator(Estimator estimatorToUse, int windowSize)
+            : estimator(estimatorToUse), windowRef(1, windowSize), windowTarget(1, windowSize)
+        {
+            crossCorrelator.prepare(windowSize, 4);
+            gccPhat.prepare(windowSize);
+            phaseSlope.prepare(windowSize);
+        }
+
+        // Collect samples; returns true once a full window is ready for estimate()
+        bool push(const float* ref, const float* target, int numSamples, int& numConsumed)
+        {
+            // The last window was full, whether or not it was estimated
+            if (fill == windowRef.getNumSamples())
+                fill = 0;
+
+            numConsumed = juce::jmin(numSamples, windowRef.getNumSamples() - fill);
+            windowRef.copyFrom(0, fill, ref, numConsumed);
+            windowTarget.copyFrom(0, fill, target, numConsumed);
+            fill += numConsumed;
+
+            if (estimator == Estimator::gccPhat)
+                gccPhat.pushSamples(ref, target, numConsumed);
+
+            return fill == windowRef.getNumSamples();
+        }
+
+        float estimate(int maxLagSamples)
+        {
+            const int numSamples = windowRef.getNumSamples();
+            const float* ref = windowRef.getReadPointer(0);
+            const float* target = windowTarget.getReadPointer(0);
+
+            switch (estimator)
+            {
+                case Estimator::gccPhat:
+                    return static_cast<float>(gccPhat.estimateDelay(ref, target, numSamples, maxLagSamples));
+                case Estimator::phaseSlope:
+                    return phaseSlope.estimateDelay(ref, target, numSamples, maxLagSamples);
+                case Estimator::crossCorrelation:
+                default:
+                    return crossCorrelator.estimateDelay(ref, target, numSamples, maxLagSamples);
+            }
+        }
+
+        // The stream left the analysed part of the beat
+        void interrupt()
+        {
+            fill = 0;
+            gccPhat.discardPartialSegment();
+        }
+
+        // GCC-PHAT reports its running cross-spectrum, so its windows need no estimate of their own
+        bool accumulates() const { return estimator == Estimator::gccPhat; }
+        bool hasAccumulatedDelay() const { return estimator == Estimator::gccPhat && gccPhat.hasAccumulatedSpectrum(); }
+        float getAccumulatedDelay(int maxLagSamples) { return static_cast<float>(gccPhat.getAccumulatedDelay(maxLagSamples)); }
+
+    private:
+        Estimator estimator;
+        juce::AudioBuffer<float> windowRef;
+        juce::AudioBuffer<float> windowTarget;
+        int fill = 0;
+        CrossCorrelator crossCorrelator;
+        GccPhatEstimator gccPhat;
+        PhaseSlopeEstimator phaseSlope;
+    };
+
+    float median(std::vector<float> values)
+    {
+        if (values.empty())
+            return 0.0f;
+
+        auto middle = values.begin() + static_cast<std::ptrdiff_t>(values.size() / 2);
+        std::nth_element(values.begin(), middle, values.end());
+        return *middle;
+    }
+
+    std::unique_ptr<juce::AudioFormatReader> openReader(juce::AudioFormatManager& formats, const juce::File& file, juce::String& error)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(file));
+        if (reader == nullptr)
+            error = "cannot read " + file.getFullPathName();
+        return reader;
+    }
+
+    //==============================================================================
+    bool analyse(juce::AudioFormatReader& refReader, juce::AudioFormatReader& targetReader,
+                 const Settings& settings, int maxLagSamples, Result& result)
+    {
+        const double sampleRate = refReader.sampleRate;
+        const int blockSize = juce::jmax(64, settings.blockSize);
+        const int windowSize = juce::nextPowerOfTwo(maxLagSamples + 1);
+        const juce::int64 length = juce::jmin(refReader.lengthInSamples, targetReader.lengthInSamples);
+        const bool useBeatGrid = settings.bpm > 0.0;
+        const double beatsPerSample = settings.bpm / (60.0 * sampleRate);
+
+        MonoStream refStream(refReader, blockSize);
+        MonoStream targetStream(targetReader, blockSize);
+        WindowEstimator estimator(settings.estimator, windowSize);
+        std::vector<float> windowLags;
+
+        juce::int64 currentBeat = std::numeric_limits<juce::int64>::min();
+        bool beatReported = false;
+        bool wasInside = false;
+
+        for (juce::int64 blockStart = 0; blockStart < length; blockStart += blockSize)
+        {
+            const int numSamples = static_cast<int>(juce::jmin<juce::int64>(blockSize, length - blockStart));
+            const float* ref = refStream.read(blockStart, numSamples);
+            const float* target = targetStream.read(blockStart, numSamples);
+
+            int i = 0;
+            while (i < numSamples)
+            {
+                // Find the run of samples that share one beat and one inside/outside state
+                juce::int64 beat = 0;
+                bool inside = true;
+                int runEnd = numSamples;
+
+                if (useBeatGrid)
+                {
+                    const auto classify = [&](int index, juce::int64& beatOut)
+                    {
+                        const double position = (static_cast<double>(blockStart + index) - settings.firstBeatSeconds * sampleRate) * beatsPerSample;
+                        beatOut = static_cast<juce::int64>(std::floor(position));
+                        const double phase = position - std::floor(position);
+                        return phase > settings.leftPPQ && phase < settings.rightPPQ;
+                    };
+
+                    inside = classify(i, beat);
+                    runEnd = i + 1;
+                    juce::int64 nextBeat = beat;
+                    while (runEnd < numSamples && classify(runEnd, nextBeat) == inside && nextBeat == beat)
+                        ++runEnd;
+                }
+
+                if (beat != currentBeat)
+                {
+                    currentBeat = beat;
+                    beatReported = false;
+                }
+
+                if (! inside)
+                {
+                    if (wasInside)
+                        estimator.interrupt();
+                    wasInside = false;
+                    i = runEnd;
+                    continue;
+                }
+
+                wasInside = true;
+                while (i < runEnd)
+                {
+                    int numConsumed = 0;
+                    if (estimator.push(ref + i, target + i, runEnd - i, numConsumed))
+                    {
+                        ++result.numWindows;
+
+                        // The first full window of each beat stands for that beat
+                        const bool reportBeat = useBeatGrid && ! beatReported;
+                        if (reportBeat || ! estimator.accumulates())
+                        {
+                            const float lag = estimator.estimate(maxLagSamples);
+                            windowLags.push_back(lag);
+
+                            if (reportBeat)
+                            {
+                                result.beatLags.push_back({ beat, lag });
+                                beatReported = true;
+                            }
+                        }
+                    }
+                    i += numConsumed;
+                }
+            }
+        }
+
+        if (result.numWindows == 0 && ! estimator.hasAccumulatedDelay())
+        {
+            result.error = "not enough overlapping audio to estimate a delay";
+            return false;
+        }
+
+        // GCC-PHAT uses its running cross-spectrum, the others the median window estimate
+        result.lagSamples = estimator.hasAccumulatedDelay() ? estimator.getAccumulatedDelay(maxLagSamples)
+                                                            : median(windowLags);
+        return true;
+    }
+
+    //==============================================================================
+    bool writeAligned(juce::AudioFormatManager& formats, juce::AudioFormatReader& targetReader,
+                      const Settings& settings, Result& result)
+    {
+        auto* format = formats.findFormatForFileExtension(result.target.getFileExtension());
+        if (format == nullptr)
+        {
+            result.error = "no writer for " + result.target.getFileExtension();
+            return false;
+        }
+
+        // The target is still being read from, so it must never be the file written
+        const auto output = getOutputFile(result.target, settings);
+        if (isSameFile(output, result.target) || isSameFile(output, result.reference))
+        {
+            result.error = "refusing to overwrite an input: " + output.getFullPathName();
+            return false;
+        }
+
+        // Written to a temporary sibling and moved into place once complete
+        juce::TemporaryFile temporary(output);
+        auto stream = std::make_unique<juce::FileOutputStream>(temporary.getFile());
+        if (! stream->openedOk())
+        {
+            result.error = "cannot write " + temporary.getFile().getFullPathName();
+            return false;
+        }
+
+        const auto numChannels = targetReader.numChannels;
+        std::unique_ptr<juce::AudioFormatWriter> writer(format->createWriterFor(stream.get(), targetReader.sampleRate, numChannels,
+                                                                                static_cast<int>(targetReader.bitsPerSample), {}, 0));
+        if (writer == nullptr)
+        {
+            result.error = "cannot create a writer for " + output.getFullPathName();
+            return false;
+        }
+        stream.release(); // The writer owns the stream now
+
+        // Advancing by `lag` is a delay of (latency - lag) followed by dropping latency samples.
+        // The latency is the lag rounded up, so any lag fits, early targets included.
+        if (! std::isfinite(result.lagSamples))
+        {
+            result.error = "no usable lag to write " + output.getFullPathName();
+            return false;
+        }
+
+        const int blockSize = juce::jmax(64, settings.blockSize);
+        const int latency = juce::jmax(0, static_cast<int>(std::ceil(result.lagSamples)));
+        const float delay = static_cast<float>(latency) - result.lagSamples;
+        FractionalDelayLine delayLine;
+        delayLine.prepare(static_cast<int>(numChannels), static_cast<int>(std::ceil(delay)), blockSize, 1);
+        delayLine.setCurrentAndTargetDelay(delay);
+
+        juce::AudioBuffer<float> buffer(static_cast<int>(numChannels), blockSize);
+        const juce::int64 length = targetReader.lengthInSamples;
+        juce::int64 numToSkip = latency;
+
+        // Read past the end by the latency so the tail is flushed; the reader zero-fills beyond the file
+        for (juce::int64 blockStart = 0; blockStart < length + latency; blockStart += blockSize)
+        {
+            const int numSamples = static_cast<int>(juce::jmin<juce::int64>(blockSize, length + latency - blockStart));
+            targetReader.read(&buffer, 0, numSamples, blockStart, true, true);
+            delayLine.process(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), numSamples);
+
+            const int skip = static_cast<int>(juce::jmin<juce::int64>(numToSkip, numSamples));
+            numToSkip -= skip;
+
+            if (numSamples > skip && ! writer->writeFromAudioSampleBuffer(buffer, skip, numSamples - skip))
+            {
+                result.error = "write failed for " + output.getFullPathName();
+                return false;
+            }
+        }
+
+        writer.reset(); // Flushes and closes the temporary file
+        if (! temporary.overwriteTargetFileWithTemporary())
+        {
+            result.error = "cannot move the aligned file to " + output.getFullPathName();
+            return false;
+        }
+
+        result.output = output;
+        return true;
+    }
+}
+
+//==============================================================================
+juce::File getOutputFile(const juce::File& target, const Settings& settings)
+{
+    if (settings.outputDirectory == juce::File())
+        return {};
+
+    return settings.outputDirectory.getChildFile(target.getFileName());
+}
+
+bool isSameFile(const juce::File& a, const juce::File& b)
+{
+    // The file itself may not exist yet, so links are followed in its directory and then in the file
+    const auto resolve = [](const juce::File& file)
+    {
+        return file.getParentDirectory().getLinkedTarget().getChildFile(file.getFileName()).getLinkedTarget();
+    };
+
+    return a != juce::File() && b != juce::File() && resolve(a) == resolve(b);
+}
+
+//==============================================================================
+Result align(const juce::File& reference, const juce::File& target, const Settings& settings)
+{
+    Result result;
+    result.reference = reference;
+    result.target = target;
+
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+
+    auto refReader = openReader(formats, reference, result.error);
+    auto targetReader = openReader(formats, target, result.error);
+    if (refReader == nullptr || targetReader == nullptr)
+        return result;
+
+    if (! juce::approximatelyEqual(refReader->sampleRate, targetReader->sampleRate))
+    {
+        result.error = "sample rates differ";
+        return result;
+    }
+
+    result.sampleRate = refReader->sampleRate;
+    const int maxLagSamples = juce::jmax(1, static_cast<int>(settings.maxDelayMs * result.sampleRate / 1000.0));
+
+    if (! analyse(*refReader, *targetReader, settings, maxLagSamples, result))
+        return result;
+
+    if (settings.outputDirectory != juce::File())
+        writeAligned(formats, *targetReader, settings, result);
+
+    return result;
+}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "CrossCorrelator.h"
+#include "GccPhatEstimator.h"
+#include "PhaseSlopeEstimator.h"
+
+//==============================================================================
+// Offline counterpart of the plugin's analysis path: streams a reference and a
+// target file block by block through the same estimators, reports one lag per
+// file (and per beat when a tempo is given), and optionally writes the target
+// advanced by that lag through FractionalDelayLine.
+//
+// Lags follow the convention in CorrelationKernels.h: positive when the target is late.
+namespace StemAligner
+{
+    enum class Estimator { crossCorrelation = 0, gccPhat, phaseSlope };
+
+    struct Settings
+    {
+        Estimator estimator = Estimator::gccPhat;
+        double maxDelayMs = 1000.0 / 30.0;   // Same search range as the plugin
+        double bpm = 0.0;                    // 0: no beat grid, consecutive windows over the whole file
+        double firstBeatSeconds = 0.0;       // Position of a downbeat in the files
+        double leftPPQ = 0.2;                // Part of each beat that is analysed, as in the plugin
+        double rightPPQ = 0.8;
+        int blockSize = 4096;                // Streaming read size
+        juce::File outputDirectory;          // Write aligned copies here; empty for analysis only
+    };
+
+    struct BeatLag
+    {
+        juce::int64 beatIndex = 0;
+        float lagSamples = 0.0f;
+    };
+
+    struct Result
+    {
+        juce::File reference;
+        juce::File target;
+        juce::File output;
+        juce::String error;                  // Non-empty if the stem could not be processed
+        double sampleRate = 0.0;
+        float lagSamples = 0.0f;
+        int numWindows = 0;
+        std::vector<BeatLag> beatLags;
+    };
+
+    // Thread-safe: every call owns its estimators, readers and buffers.
+    // The aligned copy is written to a temporary file next to getOutputFile() and moved
+    // over it once complete. It is refused if it would replace the reference or target.
+    Result align(const juce::File& reference, const juce::File& target, const Settings& settings);
+
+    // Where align() writes the aligned copy of target; an empty File for analysis only
+    juce::File getOutputFile(const juce::File& target, const Settings& settings);
+
+    // True if both paths name the same file once symbolic links in them are followed
+    bool isSameFile(const juce::File& a, const juce::File& b);
+}
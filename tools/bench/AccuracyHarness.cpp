@@ -0,0 +1,464 @@
+#include <JuceHeader.h>
+#include <chrono>
+#include <functional>
+#include <map>
+#include "AccuracyHarness.h"
+#include "CorrelationKernels.h"
+#include "DelayTracker.h"
+#include "LongRangeCorrelator.h"
+#include "PluginProcessor.h"
+
+//==============================================================================
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int sincHalfLength = 32;      // Taps either side of the interpolation point
+    constexpr int maxCaseDelay = 1024;      // Headroom before the reference window starts, unless the case needs more
+    constexpr double longRangeMaxDelayMs = 500.0;   // Same search range and decimated rate as the plugin's long-range mode
+    constexpr double longRangeAnalysisRate = 6000.0;
+    constexpr int longRangePartitionSize = 512;
+    constexpr int longRangeBlockSize = 512;
+
+    //==============================================================================
+    // Blackman-windowed sinc interpolation of source at a fractional position
+    float interpolate(const std::vector<float>& source, double position)
+    {
+        const auto base = static_cast<int>(std::floor(position));
+        const double frac = position - base;
+        double sum = 0.0;
+
+        for (int k = -sincHalfLength + 1; k <= sincHalfLength; ++k)
+        {
+            const double x = static_cast<double>(k) - frac;
+            const double sinc = std::abs(x) < 1.0e-9 ? 1.0 : std::sin(juce::MathConstants<double>::pi * x) / (juce::MathConstants<double>::pi * x);
+            const double phase = juce::MathConstants<double>::pi * (x + sincHalfLength) / sincHalfLength; // 0 .. 2 pi across the taps
+            const double window = 0.42 - 0.5 * std::cos(phase) + 0.08 * std::cos(2.0 * phase);
+            sum += source[static_cast<size_t>(base + k)] * sinc * window;
+        }
+
+        return static_cast<float>(sum);
+    }
+
+    void makePair(const AccuracyHarness::Case& testCase, double sampleRate, int windowSize, juce::AudioBuffer<float>& pair)
+    {
+        // Seeded per case so every run and every estimator sees the same samples
+        juce::Random random(static_cast<juce::int64>(testCase.name.hashCode()));
+        const int headroom = juce::jmax(maxCaseDelay, static_cast<int>(std::ceil(testCase.delaySamples)) + 1);
+        const int sourceLength = windowSize + headroom + 2 * sincHalfLength;
+        std::vector<float> source(static_cast<size_t>(sourceLength));
+        for (auto& sample : source)
+            sample = random.nextFloat() * 2.0f - 1.0f;
+
+        // Band-limit the source, so reference and target share the same spectrum
+        if (testCase.band != AccuracyHarness::Band::full)
+        {
+            juce::IIRFilter lowPass;
+            lowPass.setCoefficients(juce::IIRCoefficients::makeLowPass(sampleRate, testCase.band == AccuracyHarness::Band::lowPass ? 1000.0 : 3000.0));
+            lowPass.processSamples(source.data(), sourceLength);
+
+            if (testCase.band == AccuracyHarness::Band::bandPass)
+            {
+                juce::IIRFilter highPass;
+                highPass.setCoefficients(juce::IIRCoefficients::makeHighPass(sampleRate, 300.0));
+                highPass.processSamples(source.data(), sourceLength);
+            }
+        }
+
+        pair.setSize(2, windowSize);
+        const int start = headroom + sincHalfLength;
+        const float gain = testCase.invertPolarity ? -1.0f : 1.0f;
+        for (int i = 0; i < windowSize; ++i)
+        {
+            pair.setSample(0, i, source[static_cast<size_t>(start + i)]);
+            pair.setSample(1, i, gain * interpolate(source, start + i - static_cast<double>(testCase.delaySamples)));
+        }
+
+        // Independent noise on the target only, scaled to the requested SNR
+        if (testCase.snrDb > 0.0)
+        {
+            const float noiseRms = pair.getRMSLevel(0, 0, windowSize) * juce::Decibels::decibelsToGain(static_cast<float>(-testCase.snrDb));
+            const float noiseScale = noiseRms * std::sqrt(3.0f); // Uniform noise in [-1, 1] has an RMS of 1 / sqrt(3)
+            for (int i = 0; i < windowSize; ++i)
+                pair.setSample(1, i, pair.getSample(1, i) + noiseScale * (random.nextFloat() * 2.0f - 1.0f));
+        }
+    }
+
+    AccuracyHarness::Result measure(const juce::String& estimator, const AccuracyHarness::Case& testCase, int iterations,
+                                    const std::function<float()>& call)
+    {
+        AccuracyHarness::Result result;
+        result.estimator = estimator;
+        result.caseName = testCase.name;
+        result.trueDelay = testCase.delaySamples;
+        result.estimate = call();
+        result.errorSamples = std::abs(static_cast<double>(result.estimate) - testCase.delaySamples);
+
+        volatile float sink = 0.0f;
+        const auto start = Clock::now();
+        for (int i = 0; i < iterations; ++i)
+            sink = call();
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+        juce::ignoreUnused(sink);
+
+        result.microsecondsPerCall = static_cast<double>(elapsed) / 1000.0 / juce::jmax(1, iterations);
+        return result;
+    }
+}
+
+//==============================================================================
+std::vector<AccuracyHarness::Case> AccuracyHarness::getCases()
+{
+    return {
+        { "int-0",                  0.0f,    0.0,  false, Band::full },
+        { "int-1",                  1.0f,    0.0,  false, Band::full },
+        { "int-17",                 17.0f,   0.0,  false, Band::full },
+        { "int-250",                250.0f,  0.0,  false, Band::full },
+        { "int-1000",               1000.0f, 0.0,  false, Band::full },
+        { "frac-12.25",             12.25f,  0.0,  false, Band::full },
+        { "frac-37.5",              37.5f,   0.0,  false, Band::full },
+        { "frac-480.75",            480.75f, 0.0,  false, Band::full },
+        { "snr20-37.5",             37.5f,   20.0, false, Band::full },
+        { "snr6-37.5",              37.5f,   6.0,  false, Band::full },
+        { "invert-37.5",            37.5f,   0.0,  true,  Band::full },
+        { "lowpass-37.5",           37.5f,   0.0,  false, Band::lowPass },
+        { "bandpass-250",           250.0f,  0.0,  false, Band::bandPass },
+        { "lowpass-snr10-480.75",   480.75f, 10.0, false, Band::lowPass },
+    };
+}
+
+std::vector<AccuracyHarness::Case> AccuracyHarness::getLongRangeCases()
+{
+    return {
+        { "long-4800",              4800.0f,    0.0,  false, Band::full },
+        { "long-12000.25",          12000.25f,  0.0,  false, Band::full },
+        { "long-snr10-23040.5",     23040.5f,   10.0, false, Band::lowPass },
+    };
+}
+
+std::vector<AccuracyHarness::Result> AccuracyHarness::run(const Settings& settings)
+{
+    // No blocks are pushed, so the analysis thread stays idle and the estimators can be called from here
+    AudioPluginAudioProcessor processor;
+    processor.enableAllBuses();
+    processor.setRateAndBufferSizeDetails(settings.sampleRate, 512);
+    processor.prepareToPlay(settings.sampleRate, 512);
+    if (auto* parameter = processor.getValueTreeState().getParameter("estimator"))
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(static_cast<float>(Params::Estimator::gccPhat)));
+
+    // Same window as the plugin's analysis thread uses at this rate
+    const int windowSize = juce::nextPowerOfTwo(static_cast<int>(settings.sampleRate / 30.0));
+    juce::AudioBuffer<float> pair;
+    std::vector<Result> results;
+
+    for (const auto& testCase : getCases())
+    {
+        makePair(testCase, settings.sampleRate, windowSize, pair);
+        const float* ref = pair.getReadPointer(0);
+        const float* target = pair.getReadPointer(1);
+        const int n = settings.iterations;
+
+        results.push_back(measure("crossCorrelation", testCase, n, [&] { return processor.crossCorrelation(ref, target, windowSize, windowSize); }));
+        results.push_back(measure("fftPhaseDelay", testCase, n, [&] { return processor.fftPhaseDelay(pair); }));
+        results.push_back(measure("gccPhat", testCase, n, [&] { return processor.findDelay(pair); }));
+        results.push_back(measure("peakAlignment", testCase, n, [&] { return static_cast<float>(processor.peakAlignment(ref, target, windowSize)); }));
+    }
+
+    // The long-range search streams its input, so each call feeds the whole pair block by block from a reset
+    LongRangeCorrelator longRange;
+    const int maxLongRangeDelay = static_cast<int>(longRangeMaxDelayMs * settings.sampleRate / 1000.0);
+    longRange.prepare(maxLongRangeDelay, juce::jmax(1, juce::roundToInt(settings.sampleRate / longRangeAnalysisRate)), longRangePartitionSize, 1);
+    const int longRangeLength = longRange.getSamplesForFirstEstimate() + 4 * longRangeBlockSize;
+
+    for (const auto& testCase : getLongRangeCases())
+    {
+        makePair(testCase, settings.sampleRate, longRangeLength, pair);
+        results.push_back(measure("longRange", testCase, settings.iterations, [&]
+        {
+            longRange.reset();
+            for (int offset = 0; offset < longRangeLength; offset += longRangeBlockSize)
+            {
+                const float* target = pair.getReadPointer(1, offset);
+                longRange.pushSamples(pair.getReadPointer(0, offset), &target, 1, juce::jmin(longRangeBlockSize, longRangeLength - offset));
+            }
+            return longRange.getDelay(maxLongRangeDelay);
+        }));
+    }
+
+    processor.releaseResources();
+    return results;
+}
+
+Benchmarks::Comparison AccuracyHarness::checkKernels(const Settings& settings)
+{
+    using CorrelationKernels::Isa;
+
+    const int windowSize = juce::nextPowerOfTwo(static_cast<int>(settings.sampleRate / 30.0));
+    const int numLags = windowSize - 1; // Not a multiple of four, so the leftover lags run too
+    std::vector<float> correlation(static_cast<size_t>(numLags));
+    juce::AudioBuffer<float> pair;
+    Benchmarks::Comparison comparison;
+
+    for (auto isa : { Isa::generic, Isa::sse2, Isa::avx2, Isa::avx512 })
+    {
+        for (int kernelSize : { 0, windowSize })
+        {
+            // The any-size kernel, then the one specialised on this window size
+            juce::String name("correlate/" + juce::String(CorrelationKernels::getIsaName(isa)));
+            if (kernelSize > 0)
+            {
+                if (! CorrelationKernels::isSpecialised(isa, kernelSize))
+                    continue;
+
+                name << "/" << kernelSize;
+            }
+
+            if (! CorrelationKernels::isAvailable(isa))
+            {
+                comparison.report.add(name + ": not available on this CPU");
+                continue;
+            }
+
+            const auto correlate = CorrelationKernels::getCorrelateFunction(isa, kernelSize);
+            double worstError = 0.0;
+
+            for (const auto& testCase : getCases())
+            {
+                makePair(testCase, settings.sampleRate, windowSize, pair);
+                const float* ref = pair.getReadPointer(0);
+                const float* target = pair.getReadPointer(1);
+                correlate(ref, target, windowSize, 0, numLags, correlation.data());
+
+                for (int lag = 0; lag < numLags; ++lag)
+                {
+                    double sum = 0.0, magnitude = 0.0;
+                    for (int i = 0; i < windowSize - lag; ++i)
+                    {
+                        const double product = static_cast<double>(ref[i]) * target[i + lag];
+                        sum += product;
+                        magnitude += std::abs(product);
+                    }
+
+                    const double error = magnitude > 0.0 ? std::abs(correlation[static_cast<size_t>(lag)] - sum) / magnitude : 0.0;
+                    worstError = juce::jmax(worstError, error);
+
+                    if (error > kernelTolerance)
+                    {
+                        // The first bad lag is enough to show which case breaks the kernel
+                        comparison.report.add(name + "/" + testCase.name + ": lag " + juce::String(lag) + " is " + juce::String(correlation[static_cast<size_t>(lag)])
+                                              + " vs " + juce::String(sum) + " in double precision");
+                        ++comparison.numRegressions;
+                        break;
+                    }
+                }
+            }
+
+            comparison.report.add(name + ": largest relative error " + juce::String(worstError, 9));
+        }
+    }
+
+    return comparison;
+}
+
+Benchmarks::Comparison AccuracyHarness::checkTracker(const Settings& settings)
+{
+    constexpr float measuredDelay = 37.5f;
+    constexpr float confidenceDb = 20.0f;
+    constexpr int numRepeats = 8;
+    const auto hop = static_cast<juce::int64>(settings.sampleRate / 60.0); // Half the analysis window
+
+    DelayTracker tracker;
+    tracker.prepare(settings.sampleRate, 0.1f, 2.0);
+    Benchmarks::Comparison comparison;
+    const auto fail = [&comparison](const juce::String& message)
+    {
+        comparison.report.add("tracker: " + message);
+        ++comparison.numRegressions;
+    };
+
+    if (! tracker.update(measuredDelay, confidenceDb, 0))
+        fail("the first measurement was not fused");
+
+    tracker.predict(hop);
+    const float uncertainty = tracker.getUncertainty();
+
+    for (int i = 0; i < numRepeats; ++i)
+    {
+        if (tracker.update(measuredDelay, confidenceDb, 0))
+            fail("repeat " + juce::String(i + 1) + " of measurement 0 was fused again");
+    }
+
+    if (tracker.getUncertainty() < uncertainty)
+        fail("repeating a measurement shrank the uncertainty from " + juce::String(uncertainty, 6)
+             + " to " + juce::String(tracker.getUncertainty(), 6) + " samples");
+
+    if (! tracker.update(measuredDelay, confidenceDb, 1) || tracker.getUncertainty() >= uncertainty)
+        fail("a new measurement did not shrink the uncertainty");
+
+    comparison.report.add("tracker: uncertainty " + juce::String(uncertainty, 6) + " samples after " + juce::String(numRepeats)
+                          + " repeats, " + juce::String(tracker.getUncertainty(), 6) + " after a new measurement");
+    return comparison;
+}
+
+Benchmarks::Comparison AccuracyHarness::checkAlignment(const Settings& settings)
+{
+    constexpr int blockSize = 512;
+    constexpr double bpm = 120.0;
+    constexpr double settleSeconds = 3.0;
+    constexpr double totalSeconds = 6.0;
+    constexpr int maxLagSamples = 64;       // Headroom either side of the sidechain
+
+    struct AlignmentCase
+    {
+        int lagSamples;                     // Positive when the target is late
+        float lookaheadMs;
+    };
+
+    // A late target needs the lookahead; an early one is corrected without latency
+    const AlignmentCase cases[] = { { 37, 2.0f }, { -37, 0.0f } };
+
+    const int numBlocks = static_cast<int>(totalSeconds * settings.sampleRate) / blockSize;
+    const int settledBlock = static_cast<int>(settleSeconds * settings.sampleRate) / blockSize;
+    std::vector<float> reference(static_cast<size_t>(numBlocks * blockSize + 2 * maxLagSamples));
+    juce::Random random(0x5eed);
+    for (auto& sample : reference)
+        sample = random.nextFloat() * 2.0f - 1.0f;
+
+    Benchmarks::Comparison comparison;
+    for (const auto& alignmentCase : cases)
+    {
+        AudioPluginAudioProcessor processor;
+        processor.enableAllBuses(); // The sidechain is off by default
+        if (auto* parameter = processor.getValueTreeState().getParameter("lookahead"))
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(alignmentCase.lookaheadMs));
+        processor.setRateAndBufferSizeDetails(settings.sampleRate, blockSize);
+        processor.prepareToPlay(settings.sampleRate, blockSize);
+
+        Benchmarks::SimulatedPlayHead playHead(settings.sampleRate, bpm);
+        processor.setPlayHead(&playHead);
+
+        juce::AudioBuffer<float> buffer(juce::jmax(processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels()), blockSize);
+        juce::MidiBuffer midi;
+        const float expected = static_cast<float>(processor.getLookaheadSamples() - alignmentCase.lagSamples);
+        float worstError = 0.0f;
+        float applied = 0.0f;
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            // White noise as the sidechain, the same noise lagSamples later as every input channel
+            const float* sidechainSamples = reference.data() + maxLagSamples + block * blockSize;
+            auto input = processor.getBusBuffer(buffer, true, 0);
+            auto sidechain = processor.getBusBuffer(buffer, true, 1);
+            for (int ch = 0; ch < input.getNumChannels(); ++ch)
+                input.copyFrom(ch, 0, sidechainSamples - alignmentCase.lagSamples, blockSize);
+            for (int ch = 0; ch < sidechain.getNumChannels(); ++ch)
+                sidechain.copyFrom(ch, 0, sidechainSamples, blockSize);
+
+            processor.processBlock(buffer, midi);
+            playHead.advance(blockSize);
+            juce::Thread::sleep(1); // A block lasts about 10 ms; the analysis needs far less
+
+            applied = processor.getAppliedDelay();
+            if (block >= settledBlock)
+                worstError = juce::jmax(worstError, std::abs(applied - expected));
+        }
+
+        processor.setPlayHead(nullptr);
+        processor.releaseResources();
+
+        const auto name = "alignment: target " + juce::String(alignmentCase.lagSamples) + " samples late, "
+                          + juce::String(alignmentCase.lookaheadMs, 1) + " ms lookahead: ";
+        comparison.report.add(name + "applied " + juce::String(applied, 3) + " samples, worst error "
+                              + juce::String(worstError, 3) + " after " + juce::String(settleSeconds, 1) + " s");
+        if (worstError > alignmentTolerance)
+        {
+            comparison.report.add(name + "the applied delay did not settle on " + juce::String(expected, 3) + " samples");
+            ++comparison.numRegressions;
+        }
+    }
+
+    return comparison;
+}
+
+//==============================================================================
+juce::String AccuracyHarness::toCsv(const std::vector<Result>& results)
+{
+    juce::String csv("estimator,case,trueDelay,estimate,errorSamples,usPerCall\n");
+
+    for (const auto& result : results)
+    {
+        csv << result.estimator << ","
+            << result.caseName << ","
+            << juce::String(result.trueDelay, 3) << ","
+            << juce::String(result.estimate, 3) << ","
+            << juce::String(result.errorSamples, 3) << ","
+            << juce::String(result.microsecondsPerCall, 3) << "\n";
+    }
+
+    return csv;
+}
+
+bool AccuracyHarness::fromCsv(const juce::String& csv, std::vector<Result>& results)
+{
+    auto lines = juce::StringArray::fromLines(csv);
+    lines.trim();
+    lines.removeEmptyStrings();
+    if (lines.isEmpty() || ! lines[0].startsWith("estimator,"))
+        return false;
+
+    for (int i = 1; i < lines.size(); ++i)
+    {
+        const auto fields = juce::StringArray::fromTokens(lines[i], ",", "");
+        if (fields.size() != 6)
+            return false;
+
+        Result result;
+        result.estimator = fields[0];
+        result.caseName = fields[1];
+        result.trueDelay = fields[2].getFloatValue();
+        result.estimate = fields[3].getFloatValue();
+        result.errorSamples = fields[4].getDoubleValue();
+        result.microsecondsPerCall = fields[5].getDoubleValue();
+        results.push_back(result);
+    }
+
+    return true;
+}
+
+Benchmarks::Comparison AccuracyHarness::compare(const std::vector<Result>& results, const std::vector<Result>& baseline,
+                                                double errorTolerance, double timeTolerance)
+{
+    std::map<juce::String, const Result*> baselineByKey;
+    for (const auto& result : baseline)
+        baselineByKey[result.getKey()] = &result;
+
+    Benchmarks::Comparison comparison;
+    for (const auto& result : results)
+    {
+        const auto key = result.getKey();
+        const auto found = baselineByKey.find(key);
+        if (found == baselineByKey.end())
+        {
+            comparison.report.add(key + ": not in baseline");
+            continue;
+        }
+
+        const auto& before = *found->second;
+        if (result.errorSamples > before.errorSamples + errorTolerance)
+        {
+            comparison.report.add(key + ": error " + juce::String(result.errorSamples, 3) + " samples vs "
+                                  + juce::String(before.errorSamples, 3) + " (estimate " + juce::String(result.estimate, 3) + ")");
+            ++comparison.numRegressions;
+        }
+
+        if (before.microsecondsPerCall > 0.0 && result.microsecondsPerCall > before.microsecondsPerCall * (1.0 + timeTolerance))
+        {
+            const double change = 100.0 * (result.microsecondsPerCall / before.microsecondsPerCall - 1.0);
+            comparison.report.add(key + ": " + juce::String(result.microsecondsPerCall, 3) + " us/call vs "
+                                  + juce::String(before.microsecondsPerCall, 3) + " (+" + juce::String(change, 1) + "%)");
+            ++comparison.numRegressions;
+        }
+    }
+
+    return comparison;
+}
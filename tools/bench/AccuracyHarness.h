@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Benchmarks.h"
+
+//==============================================================================
+// Deterministic accuracy runs for the delay estimators.
+//
+// Every case builds a reference/target pair from seeded white noise with a known
+// integer or fractional delay (windowed-sinc interpolation), optionally adding
+// noise, a polarity flip or a band limit. Each estimator the processor exposes is
+// run on every case; the absolute error and the mean CPU time per call are
+// recorded, and both can be compared against a stored baseline.
+//
+// Delays follow the plugin's convention: positive when the target is late.
+namespace AccuracyHarness
+{
+    enum class Band { full = 0, lowPass, bandPass };
+
+    struct Case
+    {
+        juce::String name;
+        float delaySamples = 0.0f;
+        double snrDb = 0.0;                 // <= 0: no added noise
+        bool invertPolarity = false;
+        Band band = Band::full;
+    };
+
+    std::vector<Case> getCases();
+
+    // Delays beyond one analysis window, for the long-range search only
+    std::vector<Case> getLongRangeCases();
+
+    struct Settings
+    {
+        double sampleRate = 48000.0;
+        int iterations = 50;                // Timed calls per estimator and case
+    };
+
+    struct Result
+    {
+        juce::String estimator;
+        juce::String caseName;
+        float trueDelay = 0.0f;
+        float estimate = 0.0f;
+        double errorSamples = 0.0;          // |estimate - trueDelay|
+        double microsecondsPerCall = 0.0;
+
+        juce::String getKey() const { return estimator + "/" + caseName; }
+    };
+
+    std::vector<Result> run(const Settings& settings);
+
+    // Runs every correlate kernel this CPU supports, any-size and specialised on the analysis window,
+    // over all lags of each case's pair and checks it against a double-precision sum. A lag fails when its error exceeds kernelTolerance times
+    // the sum of |ref[i] * target[i + lag]|. The report has one line per kernel, plus one per failing case.
+    constexpr double kernelTolerance = 1.0e-5;
+    Benchmarks::Comparison checkKernels(const Settings& settings);
+
+    // Feeds a DelayTracker the same measurement several times, then a new one. The repeats must
+    // leave its uncertainty where it was; only the new measurement may shrink it.
+    Benchmarks::Comparison checkTracker(const Settings& settings);
+
+    // Runs the processor in real time, so the analysis thread keeps up, on a target 37 samples late with
+    // 2 ms of lookahead and on one 37 samples early without. Once settled, the delay it applies must stay
+    // within alignmentTolerance samples of lookahead - lag, not drift away from it.
+    constexpr double alignmentTolerance = 0.5;
+    Benchmarks::Comparison checkAlignment(const Settings& settings);
+
+    //==============================================================================
+    juce::String toCsv(const std::vector<Result>& results);
+    bool fromCsv(const juce::String& csv, std::vector<Result>& results);
+
+    // A result regresses when its error grows by more than errorTolerance samples, or its
+    // time per call by more than timeTolerance (a fraction) over the baseline.
+    Benchmarks::Comparison compare(const std::vector<Result>& results, const std::vector<Result>& baseline,
+                                   double errorTolerance, double timeTolerance);
+}
@@ -0,0 +1,49 @@
+#include <JuceHeader.h>
+#include <cstdlib>
+#include <new>
+#include "AllocationCounter.h"
+
+//==============================================================================
+namespace
+{
+    // Thread-local, so the hooks below never take a lock and never allocate themselves
+    thread_local bool isCounting = false;
+    thread_local juce::int64 numAllocations = 0;
+
+    void* allocate(std::size_t size)
+    {
+        if (isCounting)
+            ++numAllocations;
+
+        if (void* memory = std::malloc(size == 0 ? 1 : size))
+            return memory;
+
+        throw std::bad_alloc();
+    }
+}
+
+void* operator new(std::size_t size)                                    { return allocate(size); }
+void* operator new[](std::size_t size)                                  { return allocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept    { try { return allocate(size); } catch (...) { return nullptr; } }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept  { try { return allocate(size); } catch (...) { return nullptr; } }
+void operator delete(void* memory) noexcept                             { std::free(memory); }
+void operator delete[](void* memory) noexcept                           { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept                { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept              { std::free(memory); }
+
+//==============================================================================
+ScopedAllocationCounter::ScopedAllocationCounter()
+    : startCount(numAllocations), wasCounting(isCounting)
+{
+    isCounting = true;
+}
+
+ScopedAllocationCounter::~ScopedAllocationCounter()
+{
+    isCounting = wasCounting;
+}
+
+juce::int64 ScopedAllocationCounter::getNumAllocations() const
+{
+    return numAllocations - startCount;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+//==============================================================================
+// Counts heap allocations made by the calling thread while an instance is alive.
+// The counting comes from the global operator new replacements in
+// AllocationCounter.cpp, so it only works in executables that link that file.
+// Allocations made on other threads (the analysis worker, for example) are not
+// counted.
+class ScopedAllocationCounter
+{
+public:
+    //==============================================================================
+    ScopedAllocationCounter();
+    ~ScopedAllocationCounter();
+
+    juce::int64 getNumAllocations() const;
+
+private:
+    //==============================================================================
+    juce::int64 startCount = 0;
+    bool wasCounting = false;
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ScopedAllocationCounter)
+};
@@ -0,0 +1,298 @@
+#include <JuceHeader.h>
+#include <chrono>
+#include <functional>
+#include <map>
+#include "Benchmarks.h"
+#include "AllocationCounter.h"
+#include "PluginProcessor.h"
+
+//==============================================================================
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double elapsedNanoseconds(Clock::time_point start, Clock::time_point end)
+    {
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    }
+
+    //==============================================================================
+    // White noise as the sidechain and the same noise, delayed, as the input
+    struct TestSignal
+    {
+        std::vector<float> reference;
+        std::vector<float> target;
+    };
+
+    TestSignal makeSignal(int numSamples, float delaySamples)
+    {
+        juce::Random random(0x1234);
+        TestSignal signal;
+        signal.reference.resize(static_cast<size_t>(numSamples));
+        signal.target.resize(static_cast<size_t>(numSamples));
+
+        for (auto& sample : signal.reference)
+            sample = random.nextFloat() * 2.0f - 1.0f;
+
+        // Linear interpolation is plenty for timing purposes
+        const int delayInt = static_cast<int>(delaySamples);
+        const float frac = delaySamples - static_cast<float>(delayInt);
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const int a = i - delayInt;
+            const float x0 = a >= 0 ? signal.reference[static_cast<size_t>(a)] : 0.0f;
+            const float x1 = a >= 1 ? signal.reference[static_cast<size_t>(a - 1)] : 0.0f;
+            signal.target[static_cast<size_t>(i)] = x0 + frac * (x1 - x0);
+        }
+
+        return signal;
+    }
+
+    void setParameter(AudioPluginAudioProcessor& processor, const juce::String& parameterID, float value)
+    {
+        if (auto* parameter = processor.getValueTreeState().getParameter(parameterID))
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    }
+
+    juce::String formatWindow(const Benchmarks::PpqWindow& window)
+    {
+        return juce::String(window.left, 2) + "-" + juce::String(window.right, 2);
+    }
+
+    //==============================================================================
+    Benchmarks::Result runOneProcessBlock(const Benchmarks::Settings& settings, const TestSignal& signal,
+                                          double sampleRate, int blockSize, const Benchmarks::PpqWindow& window)
+    {
+        AudioPluginAudioProcessor processor;
+        processor.enableAllBuses(); // The sidechain is off by default
+        setParameter(processor, "leftPPQ", window.left);
+        setParameter(processor, "rightPPQ", window.right);
+        processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+
+        Benchmarks::SimulatedPlayHead playHead(sampleRate, settings.bpm);
+        processor.setPlayHead(&playHead);
+
+        juce::AudioBuffer<float> buffer(juce::jmax(processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels()), blockSize);
+        juce::MidiBuffer midi;
+
+        const int numBlocks = static_cast<int>(signal.reference.size()) / blockSize;
+        double totalNanoseconds = 0.0;
+        double worstNanoseconds = 0.0;
+        juce::int64 totalAllocations = 0;
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            // Refill outside the timed region: processBlock works in place
+            const size_t offset = static_cast<size_t>(block * blockSize);
+            auto input = processor.getBusBuffer(buffer, true, 0);
+            auto sidechain = processor.getBusBuffer(buffer, true, 1);
+            for (int ch = 0; ch < input.getNumChannels(); ++ch)
+                input.copyFrom(ch, 0, signal.target.data() + offset, blockSize);
+            for (int ch = 0; ch < sidechain.getNumChannels(); ++ch)
+                sidechain.copyFrom(ch, 0, signal.reference.data() + offset, blockSize);
+
+            const auto start = Clock::now();
+            {
+                ScopedAllocationCounter allocations;
+                processor.processBlock(buffer, midi);
+                totalAllocations += allocations.getNumAllocations();
+            }
+            const double nanoseconds = elapsedNanoseconds(start, Clock::now());
+
+            totalNanoseconds += nanoseconds;
+            worstNanoseconds = juce::jmax(worstNanoseconds, nanoseconds);
+            playHead.advance(blockSize);
+        }
+
+        processor.setPlayHead(nullptr);
+        processor.releaseResources();
+
+        Benchmarks::Result result;
+        result.benchmark = "processBlock";
+        result.sampleRate = sampleRate;
+        result.blockSize = blockSize;
+        result.ppqWindow = formatWindow(window);
+        result.nsPerSample = totalNanoseconds / juce::jmax(1, numBlocks * blockSize);
+        result.worstBlockMicroseconds = worstNanoseconds / 1000.0;
+        result.allocationsPerBlock = static_cast<double>(totalAllocations) / juce::jmax(1, numBlocks);
+        return result;
+    }
+
+    Benchmarks::Result timeCalls(const juce::String& name, double sampleRate, int windowSize, int numIterations,
+                                 const std::function<void()>& call)
+    {
+        call(); // Warm the caches and any lazily built state
+
+        double totalNanoseconds = 0.0;
+        double worstNanoseconds = 0.0;
+        juce::int64 totalAllocations = 0;
+
+        for (int i = 0; i < numIterations; ++i)
+        {
+            const auto start = Clock::now();
+            {
+                ScopedAllocationCounter allocations;
+                call();
+                totalAllocations += allocations.getNumAllocations();
+            }
+            const double nanoseconds = elapsedNanoseconds(start, Clock::now());
+
+            totalNanoseconds += nanoseconds;
+            worstNanoseconds = juce::jmax(worstNanoseconds, nanoseconds);
+        }
+
+        Benchmarks::Result result;
+        result.benchmark = name;
+        result.sampleRate = sampleRate;
+        result.blockSize = windowSize;
+        result.ppqWindow = "-";
+        result.nsPerSample = totalNanoseconds / juce::jmax(1, numIterations) / windowSize;
+        result.worstBlockMicroseconds = worstNanoseconds / 1000.0;
+        result.allocationsPerBlock = static_cast<double>(totalAllocations) / juce::jmax(1, numIterations);
+        return result;
+    }
+}
+
+//==============================================================================
+juce::String Benchmarks::Result::getKey() const
+{
+    return benchmark + "/" + juce::String(juce::roundToInt(sampleRate)) + "/" + juce::String(blockSize) + "/" + ppqWindow;
+}
+
+std::vector<Benchmarks::Result> Benchmarks::runProcessBlock(const Settings& settings)
+{
+    std::vector<Result> results;
+
+    for (const double sampleRate : settings.sampleRates)
+    {
+        const auto signal = makeSignal(static_cast<int>(settings.secondsPerRun * sampleRate), settings.delaySamples);
+
+        for (const int blockSize : settings.blockSizes)
+            for (const auto& window : settings.ppqWindows)
+                results.push_back(runOneProcessBlock(settings, signal, sampleRate, blockSize, window));
+    }
+
+    return results;
+}
+
+std::vector<Benchmarks::Result> Benchmarks::runEstimators(const Settings& settings)
+{
+    std::vector<Result> results;
+
+    for (const double sampleRate : settings.sampleRates)
+    {
+        // No blocks are pushed, so the analysis thread stays idle and the estimators can be called from here
+        AudioPluginAudioProcessor processor;
+        processor.enableAllBuses();
+        processor.setRateAndBufferSizeDetails(sampleRate, 512);
+        processor.prepareToPlay(sampleRate, 512);
+        setParameter(processor, "estimator", static_cast<float>(Params::Estimator::gccPhat));
+
+        // Same window as the plugin's analysis thread uses at this rate
+        const int windowSize = juce::nextPowerOfTwo(static_cast<int>(sampleRate / 30.0));
+        const auto signal = makeSignal(windowSize, settings.delaySamples);
+        juce::AudioBuffer<float> window(2, windowSize);
+        window.copyFrom(0, 0, signal.reference.data(), windowSize);
+        window.copyFrom(1, 0, signal.target.data(), windowSize);
+        const float* ref = window.getReadPointer(0);
+        const float* target = window.getReadPointer(1);
+
+        volatile float sink = 0.0f;
+        const int n = settings.estimatorIterations;
+        results.push_back(timeCalls("crossCorrelation", sampleRate, windowSize, n, [&] { sink = processor.crossCorrelation(ref, target, windowSize, windowSize); }));
+        results.push_back(timeCalls("fftPhaseDelay", sampleRate, windowSize, n, [&] { sink = processor.fftPhaseDelay(window); }));
+        results.push_back(timeCalls("peakAlignment", sampleRate, windowSize, n, [&] { sink = static_cast<float>(processor.peakAlignment(ref, target, windowSize)); }));
+        results.push_back(timeCalls("gccPhat", sampleRate, windowSize, n, [&] { sink = processor.findDelay(window); }));
+        juce::ignoreUnused(sink);
+
+        processor.releaseResources();
+    }
+
+    return results;
+}
+
+//==============================================================================
+juce::String Benchmarks::toCsv(const std::vector<Result>& results)
+{
+    juce::String csv("benchmark,sampleRate,blockSize,ppqWindow,nsPerSample,worstBlockUs,allocationsPerBlock\n");
+
+    for (const auto& result : results)
+    {
+        csv << result.benchmark << ","
+            << juce::roundToInt(result.sampleRate) << ","
+            << result.blockSize << ","
+            << result.ppqWindow << ","
+            << juce::String(result.nsPerSample, 3) << ","
+            << juce::String(result.worstBlockMicroseconds, 3) << ","
+            << juce::String(result.allocationsPerBlock, 3) << "\n";
+    }
+
+    return csv;
+}
+
+bool Benchmarks::fromCsv(const juce::String& csv, std::vector<Result>& results)
+{
+    auto lines = juce::StringArray::fromLines(csv);
+    lines.trim();
+    lines.removeEmptyStrings();
+    if (lines.isEmpty() || ! lines[0].startsWith("benchmark,"))
+        return false;
+
+    for (int i = 1; i < lines.size(); ++i)
+    {
+        const auto fields = juce::StringArray::fromTokens(lines[i], ",", "");
+        if (fields.size() != 7)
+            return false;
+
+        Result result;
+        result.benchmark = fields[0];
+        result.sampleRate = fields[1].getDoubleValue();
+        result.blockSize = fields[2].getIntValue();
+        result.ppqWindow = fields[3];
+        result.nsPerSample = fields[4].getDoubleValue();
+        result.worstBlockMicroseconds = fields[5].getDoubleValue();
+        result.allocationsPerBlock = fields[6].getDoubleValue();
+        results.push_back(result);
+    }
+
+    return true;
+}
+
+Benchmarks::Comparison Benchmarks::compare(const std::vector<Result>& results, const std::vector<Result>& baseline, double tolerance)
+{
+    std::map<juce::String, const Result*> baselineByKey;
+    for (const auto& result : baseline)
+        baselineByKey[result.getKey()] = &result;
+
+    Comparison comparison;
+    for (const auto& result : results)
+    {
+        const auto key = result.getKey();
+        const auto found = baselineByKey.find(key);
+        if (found == baselineByKey.end())
+        {
+            comparison.report.add(key + ": not in baseline");
+            continue;
+        }
+
+        // Worst-case block times are too noisy to gate on; they are reported but only the mean and allocations fail
+        const auto& before = *found->second;
+        if (before.nsPerSample > 0.0 && result.nsPerSample > before.nsPerSample * (1.0 + tolerance))
+        {
+            const double change = 100.0 * (result.nsPerSample / before.nsPerSample - 1.0);
+            comparison.report.add(key + ": " + juce::String(result.nsPerSample, 3) + " ns/sample vs "
+                                  + juce::String(before.nsPerSample, 3) + " (+" + juce::String(change, 1) + "%)");
+            ++comparison.numRegressions;
+        }
+
+        if (result.allocationsPerBlock > before.allocationsPerBlock)
+        {
+            comparison.report.add(key + ": " + juce::String(result.allocationsPerBlock, 3) + " allocations/block vs "
+                                  + juce::String(before.allocationsPerBlock, 3));
+            ++comparison.numRegressions;
+        }
+    }
+
+    return comparison;
+}
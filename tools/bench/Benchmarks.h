@@ -0,0 +1,88 @@
+#pragma once
+
+//==============================================================================
+// Timing runs for the plugin's audio path and its delay estimators.
+//
+// processBlock runs drive a real AudioPluginAudioProcessor with a simulated
+// playhead for every combination of sample rate, block size and PPQ window.
+// Estimator runs time crossCorrelation, fftPhaseDelay, peakAlignment and the
+// GCC-PHAT path of findDelay on one analysis window per sample rate.
+//
+// Results are plain CSV rows so a run can be stored as a baseline and compared
+// against later runs.
+namespace Benchmarks
+{
+    struct PpqWindow
+    {
+        float left = 0.2f;
+        float right = 0.8f;
+    };
+
+    struct Settings
+    {
+        std::vector<double> sampleRates { 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 };
+        std::vector<int> blockSizes { 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+        std::vector<PpqWindow> ppqWindows { { 0.2f, 0.8f }, { 0.0f, 1.0f }, { 0.45f, 0.55f } };
+        double secondsPerRun = 5.0;          // Simulated audio per processBlock run
+        int estimatorIterations = 50;        // Calls per estimator run
+        double bpm = 120.0;
+        float delaySamples = 37.5f;          // Offset between the sidechain and the input signal
+    };
+
+    struct Result
+    {
+        juce::String benchmark;              // "processBlock" or the estimator name
+        double sampleRate = 0.0;
+        int blockSize = 0;                   // Block size, or the analysis window for estimators
+        juce::String ppqWindow;              // "left-right", or "-" for estimators
+        double nsPerSample = 0.0;            // Mean cost per input sample
+        double worstBlockMicroseconds = 0.0; // Slowest single block (or estimator call)
+        double allocationsPerBlock = 0.0;    // Heap allocations per block on the calling thread
+
+        juce::String getKey() const;
+    };
+
+    //==============================================================================
+    // Transport that is always playing at a fixed tempo, advanced by the caller after every block
+    class SimulatedPlayHead final : public juce::AudioPlayHead
+    {
+    public:
+        SimulatedPlayHead(double newSampleRate, double newBpm)
+            : sampleRate(newSampleRate), bpm(newBpm) {}
+
+        juce::Optional<PositionInfo> getPosition() const override
+        {
+            PositionInfo position;
+            position.setIsPlaying(true);
+            position.setBpm(bpm);
+            position.setTimeInSamples(timeInSamples);
+            position.setPpqPosition(static_cast<double>(timeInSamples) * bpm / (60.0 * sampleRate));
+            return position;
+        }
+
+        void advance(int numSamples) { timeInSamples += numSamples; }
+
+    private:
+        double sampleRate = 44100.0;
+        double bpm = 120.0;
+        juce::int64 timeInSamples = 0;
+    };
+
+    //==============================================================================
+    std::vector<Result> runProcessBlock(const Settings& settings);
+    std::vector<Result> runEstimators(const Settings& settings);
+
+    //==============================================================================
+    juce::String toCsv(const std::vector<Result>& results);
+    bool fromCsv(const juce::String& csv, std::vector<Result>& results);
+
+    // One line per result that got slower than baseline * (1 + tolerance) or allocates more than the baseline.
+    // Results missing from the baseline are listed but not counted as regressions.
+    struct Comparison
+    {
+        juce::StringArray report;
+        int numRegressions = 0;
+    };
+
+    Comparison compare(const std::vector<Result>& results, const std::vector<Result>& baseline, double tolerance);
+}
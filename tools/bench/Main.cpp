@@ -0,0 +1,202 @@
+#include <JuceHeader.h>
+#include <iostream>
+#include "AccuracyHarness.h"
+#include "Benchmarks.h"
+
+//==============================================================================
+namespace
+{
+    void printUsage()
+    {
+        std::cout << "Usage:\n"
+                     "  inPhaseBench [options]\n"
+                     "  inPhaseBench --accuracy [options]\n"
+                     "\n"
+                     "Times processBlock under a simulated playhead and the delay estimators, and writes one CSV row per run.\n"
+                     "With --accuracy, runs every estimator on synthetic signals with known delays instead, and records\n"
+                     "the error and time per call. It also checks every correlate kernel this CPU supports against a\n"
+                     "double-precision sum, and that the delay tracker fuses each measurement only once.\n"
+                     "\n"
+                     "Options:\n"
+                     "      --only <process|estimators>    Run one group of benchmarks (default both)\n"
+                     "      --sample-rates <list>          Comma-separated sample rates (default 44100 .. 192000)\n"
+                     "      --block-sizes <list>           Comma-separated block sizes (default 32 .. 4096)\n"
+                     "      --seconds <s>                  Simulated audio per processBlock run (default 5)\n"
+                     "      --iterations <n>               Calls per estimator run (default 50)\n"
+                     "      --quick                        48 kHz and 96 kHz, three block sizes, one second per run\n"
+                     "  -o, --output <file>                Write the CSV here instead of stdout\n"
+                     "      --baseline <file>              Compare against a CSV written by an earlier run\n"
+                     "      --tolerance <fraction>         Allowed slowdown against the baseline (default 0.1)\n"
+                     "      --error-tolerance <samples>    Allowed growth of an accuracy error (default 0.25)\n";
+    }
+
+    bool writeCsv(const juce::String& csv, const juce::File& output)
+    {
+        if (output == juce::File())
+        {
+            std::cout << csv;
+            return true;
+        }
+
+        if (output.replaceWithText(csv))
+            return true;
+
+        std::cerr << "cannot write " << output.getFullPathName() << "\n";
+        return false;
+    }
+
+    int report(const Benchmarks::Comparison& comparison, const juce::File& baseline)
+    {
+        // The report goes to stderr so stdout stays plain CSV
+        for (auto& line : comparison.report)
+            std::cerr << line << "\n";
+        std::cerr << comparison.numRegressions << " regression(s) against " << baseline.getFullPathName() << "\n";
+
+        return comparison.numRegressions == 0 ? 0 : 2;
+    }
+
+    int runAccuracy(int iterations, const juce::File& output, const juce::File& baseline, double errorTolerance, double timeTolerance)
+    {
+        std::vector<AccuracyHarness::Result> baselineResults;
+        if (baseline != juce::File() && ! AccuracyHarness::fromCsv(baseline.loadFileAsString(), baselineResults))
+        {
+            std::cerr << "cannot read baseline " << baseline.getFullPathName() << "\n";
+            return 1;
+        }
+
+        AccuracyHarness::Settings settings;
+        settings.iterations = iterations;
+        const auto results = AccuracyHarness::run(settings);
+
+        if (! writeCsv(AccuracyHarness::toCsv(results), output))
+            return 1;
+
+        // Every instruction set, not just the one the plugin would pick here, the tracker's fusion and the whole loop
+        int numFailures = 0;
+        for (const auto& check : { AccuracyHarness::checkKernels(settings), AccuracyHarness::checkTracker(settings), AccuracyHarness::checkAlignment(settings) })
+        {
+            for (auto& line : check.report)
+                std::cerr << line << "\n";
+            numFailures += check.numRegressions;
+        }
+
+        if (numFailures > 0)
+            return 2;
+
+        if (baseline == juce::File())
+            return 0;
+
+        return report(AccuracyHarness::compare(results, baselineResults, errorTolerance, timeTolerance), baseline);
+    }
+
+    template <typename Value>
+    std::vector<Value> parseList(const juce::String& text)
+    {
+        std::vector<Value> values;
+        for (auto& token : juce::StringArray::fromTokens(text, ",", ""))
+            if (token.trim().isNotEmpty())
+                values.push_back(static_cast<Value>(token.getDoubleValue()));
+        return values;
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    // The processor's parameter state expects a message manager
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    Benchmarks::Settings settings;
+    bool runProcess = true;
+    bool runEstimators = true;
+    juce::File output;
+    juce::File baseline;
+    double tolerance = 0.1;
+    double errorTolerance = 0.25;
+    bool accuracy = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const juce::String arg(argv[i]);
+        const auto next = [&]() -> juce::String
+        {
+            if (i + 1 < argc)
+                return juce::String(argv[++i]);
+
+            std::cerr << "missing value for " << arg << "\n";
+            std::exit(1);
+        };
+
+        if (arg == "-h" || arg == "--help")                 { printUsage(); return 0; }
+        else if (arg == "--only")
+        {
+            const auto group = next();
+            runProcess = group == "process";
+            runEstimators = group == "estimators";
+            if (! runProcess && ! runEstimators)
+            {
+                std::cerr << "unknown benchmark group " << group << "\n";
+                return 1;
+            }
+        }
+        else if (arg == "--sample-rates")                   settings.sampleRates = parseList<double>(next());
+        else if (arg == "--block-sizes")                    settings.blockSizes = parseList<int>(next());
+        else if (arg == "--seconds")                        settings.secondsPerRun = next().getDoubleValue();
+        else if (arg == "--iterations")                     settings.estimatorIterations = next().getIntValue();
+        else if (arg == "--quick")
+        {
+            settings.sampleRates = { 48000.0, 96000.0 };
+            settings.blockSizes = { 64, 512, 4096 };
+            settings.secondsPerRun = 1.0;
+            settings.estimatorIterations = 10;
+        }
+        else if (arg == "-o" || arg == "--output")          output = juce::File::getCurrentWorkingDirectory().getChildFile(next());
+        else if (arg == "--baseline")                       baseline = juce::File::getCurrentWorkingDirectory().getChildFile(next());
+        else if (arg == "--tolerance")                      tolerance = next().getDoubleValue();
+        else if (arg == "--error-tolerance")                errorTolerance = next().getDoubleValue();
+        else if (arg == "--accuracy")                       accuracy = true;
+        else
+        {
+            std::cerr << "unknown option " << arg << "\n";
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (accuracy)
+        return runAccuracy(settings.estimatorIterations, output, baseline, errorTolerance, tolerance);
+
+    if (settings.sampleRates.empty() || settings.blockSizes.empty() || settings.secondsPerRun <= 0.0)
+    {
+        std::cerr << "nothing to run\n";
+        return 1;
+    }
+
+    // Read the baseline first so a typo fails before minutes of benchmarking
+    std::vector<Benchmarks::Result> baselineResults;
+    if (baseline != juce::File() && ! Benchmarks::fromCsv(baseline.loadFileAsString(), baselineResults))
+    {
+        std::cerr << "cannot read baseline " << baseline.getFullPathName() << "\n";
+        return 1;
+    }
+
+    std::vector<Benchmarks::Result> results;
+    if (runProcess)
+    {
+        auto processResults = Benchmarks::runProcessBlock(settings);
+        results.insert(results.end(), processResults.begin(), processResults.end());
+    }
+    if (runEstimators)
+    {
+        auto estimatorResults = Benchmarks::runEstimators(settings);
+        results.insert(results.end(), estimatorResults.begin(), estimatorResults.end());
+    }
+
+    if (! writeCsv(Benchmarks::toCsv(results), output))
+        return 1;
+
+    if (baseline == juce::File())
+        return 0;
+
+    return report(Benchmarks::compare(results, baselineResults, tolerance), baseline);
+}